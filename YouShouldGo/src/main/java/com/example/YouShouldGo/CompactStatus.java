@@ -0,0 +1,68 @@
+package com.example.YouShouldGo;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.HexFormat;
+import java.util.List;
+
+/**
+ * Fixed-layout binary form of TramStatus for the ESP32 (mirrored by compactstatus.h).
+ *
+ * Little endian, always SIZE bytes:
+ *   u8 version | u8 state | u8 count | u8 flags | u32 seq | u32 dataTimestamp (unix s)
+ *   then MAX_APPROACHING x { i32 vehicleId | i16 stopsAway | u16 etaSeconds }, unused slots zeroed
+ * flags and etaSeconds are only set by the device's own computation, always 0 here.
+ *
+ * /api/status/batch sends BATCH_HEADER_SIZE + count * SIZE bytes, one status per watched stop
+ * in request order:
+ *   u8 batchVersion | u8 count | u16 reserved, then count x the layout above
+ */
+public final class CompactStatus {
+
+    public static final int VERSION = 1;
+    public static final int SIZE = 12 + TramOrientationService.MAX_APPROACHING * 8;
+    public static final int BATCH_VERSION = 1;
+    public static final int BATCH_HEADER_SIZE = 4;
+    public static final int MAX_BATCH = 8;
+
+    private CompactStatus() {}
+
+    public static byte[] encode(TramOrientationService.TramStatus status) {
+        List<TramOrientationService.VehicleApproach> approaching = status.approaching();
+        int count = Math.min(approaching.size(), TramOrientationService.MAX_APPROACHING);
+
+        ByteBuffer buffer = ByteBuffer.allocate(SIZE).order(ByteOrder.LITTLE_ENDIAN);
+        buffer.put((byte) VERSION);
+        buffer.put((byte) status.state());
+        buffer.put((byte) count);
+        buffer.put((byte) 0);
+        buffer.putInt((int) status.seq());
+        buffer.putInt((int) status.dataTimestamp());
+
+        for (int i = 0; i < count; i++) {
+            TramOrientationService.VehicleApproach vehicle = approaching.get(i);
+            buffer.putInt(vehicle.vehicleId() != null ? vehicle.vehicleId() : -1);
+            buffer.putShort((short) Math.min(vehicle.stopsAway(), Short.MAX_VALUE));
+            buffer.putShort((short) 0);
+        }
+        return buffer.array();
+    }
+
+    public static byte[] encodeBatch(List<TramOrientationService.TramStatus> statuses) {
+        int count = Math.min(statuses.size(), MAX_BATCH);
+
+        ByteBuffer buffer = ByteBuffer.allocate(BATCH_HEADER_SIZE + count * SIZE).order(ByteOrder.LITTLE_ENDIAN);
+        buffer.put((byte) BATCH_VERSION);
+        buffer.put((byte) count);
+        buffer.putShort((short) 0);
+        for (int i = 0; i < count; i++) {
+            buffer.put(encode(statuses.get(i)));
+        }
+        return buffer.array();
+    }
+
+    // For the SSE stream, which is text only
+    public static String encodeHex(TramOrientationService.TramStatus status) {
+        return HexFormat.of().formatHex(encode(status));
+    }
+}
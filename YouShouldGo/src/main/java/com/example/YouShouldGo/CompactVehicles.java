@@ -0,0 +1,57 @@
+package com.example.YouShouldGo;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.List;
+
+/**
+ * Binary vehicle-position feed of one or more trips for the ESP32 (mirrored by localstatus.h).
+ *
+ * The device matches vehicles to stops, counts stops away and estimates arrival
+ * itself, so this only carries positions and speeds. Little endian,
+ * HEADER_SIZE + count * RECORD_SIZE bytes:
+ *   u8 version | u8 count | u16 reserved | u32 dataTimestamp (unix s)
+ *   then count x { i32 vehicleId | i32 lat | i32 lon | u16 speed | u8 trip | u8 reserved },
+ *   coordinates in microdegrees, speed in 0.1 km/h, trip the index of the
+ *   vehicle's trip in the request
+ */
+public final class CompactVehicles {
+
+    public static final int VERSION = 3;
+    public static final int HEADER_SIZE = 8;
+    public static final int RECORD_SIZE = 16;
+    public static final int MAX_TRIPS = 8;              // a device's whole watchlist
+    public static final int MAX_VEHICLES_PER_TRIP = 16; // keeps count within a byte
+
+    private CompactVehicles() {}
+
+    // trips[i] are the vehicles of the i-th trip asked for
+    public static byte[] encode(List<List<TramOrientationService.Vehicle>> trips, long dataTimestamp) {
+        int tripCount = Math.min(trips.size(), MAX_TRIPS);
+        int count = 0;
+        for (int t = 0; t < tripCount; t++) {
+            count += Math.min(trips.get(t).size(), MAX_VEHICLES_PER_TRIP);
+        }
+
+        ByteBuffer buffer = ByteBuffer.allocate(HEADER_SIZE + count * RECORD_SIZE).order(ByteOrder.LITTLE_ENDIAN);
+        buffer.put((byte) VERSION);
+        buffer.put((byte) count);
+        buffer.putShort((short) 0);
+        buffer.putInt((int) dataTimestamp);
+
+        for (int t = 0; t < tripCount; t++) {
+            List<TramOrientationService.Vehicle> vehicles = trips.get(t);
+            for (int i = 0; i < Math.min(vehicles.size(), MAX_VEHICLES_PER_TRIP); i++) {
+                TramOrientationService.Vehicle vehicle = vehicles.get(i);
+                buffer.putInt(vehicle.id() != null ? vehicle.id() : -1);
+                buffer.putInt((int) Math.round(vehicle.latitude() * 1e6));
+                buffer.putInt((int) Math.round(vehicle.longitude() * 1e6));
+                double speed = vehicle.speed() != null ? vehicle.speed() : 0;
+                buffer.putShort((short) Math.min(Math.max(Math.round(speed * 10), 0), 0xFFFF));
+                buffer.put((byte) t);
+                buffer.put((byte) 0);
+            }
+        }
+        return buffer.array();
+    }
+}
@@ -0,0 +1,206 @@
+package com.example.YouShouldGo;
+
+import org.springframework.beans.factory.annotation.Value;
+import org.springframework.context.annotation.Profile;
+import org.springframework.core.io.ClassPathResource;
+import org.springframework.http.HttpStatus;
+import org.springframework.http.MediaType;
+import org.springframework.http.ResponseEntity;
+import org.springframework.util.MultiValueMap;
+import org.springframework.web.bind.annotation.*;
+import org.springframework.web.context.request.WebRequest;
+import tools.jackson.core.type.TypeReference;
+import tools.jackson.databind.json.JsonMapper;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.UncheckedIOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ThreadLocalRandom;
+
+/**
+ * Local stand-in for the live API under the "replay" profile, for measuring the firmware.
+ *
+ * Serves recorded responses instead of asking Tranzy: routes-with-vehicles.json, trips.json,
+ * stations-with-vehicles.json, vehicles.json and status.json (a TramStatus) from replay.dir, falling back
+ * to the samples in resources/replay. Record them from a running backend with curl.
+ * There is one recorded trip: its stations are served whatever tripId is asked for, and
+ * every stop of a status batch gets the recorded status.
+ * Every request first waits replay.latency-ms +- replay.jitter-ms and then fails with 503
+ * with probability replay.failure-rate. replay.payload-scale repeats the catalogs to
+ * simulate a larger agency.
+ */
+@RestController
+@Profile("replay")
+public class ReplayController {
+
+    static final int SCALE_ID_STRIDE = 100000; // route_id offset of each repeated copy
+    private static final String RETRY_AFTER_S = "2";
+
+    private final List<TramOrientationService.Route> routes;
+    private final List<TramOrientationService.Trip> trips;
+    private final List<TramOrientationService.StationWithVehicle> stations;
+    private final List<TramOrientationService.Vehicle> vehicles;
+    private final TramOrientationService.TramStatus status;
+
+    private final long latencyMs;
+    private final long jitterMs;
+    private final double failureRate;
+
+    public ReplayController(JsonMapper mapper,
+                            @Value("${replay.dir:replay}") String dir,
+                            @Value("${replay.latency-ms:0}") long latencyMs,
+                            @Value("${replay.jitter-ms:0}") long jitterMs,
+                            @Value("${replay.failure-rate:0}") double failureRate,
+                            @Value("${replay.payload-scale:1}") int payloadScale) {
+        Path recordings = Path.of(dir);
+        int scale = Math.max(payloadScale, 1);
+        this.routes = scaleRoutes(load(mapper, recordings, "routes-with-vehicles.json",
+                new TypeReference<List<TramOrientationService.Route>>() {}), scale);
+        this.trips = scaleTrips(load(mapper, recordings, "trips.json",
+                new TypeReference<List<TramOrientationService.Trip>>() {}), scale);
+        this.stations = scaleStations(load(mapper, recordings, "stations-with-vehicles.json",
+                new TypeReference<List<TramOrientationService.StationWithVehicle>>() {}), scale);
+        this.vehicles = load(mapper, recordings, "vehicles.json", new TypeReference<List<TramOrientationService.Vehicle>>() {});
+        this.status = load(mapper, recordings, "status.json", new TypeReference<TramOrientationService.TramStatus>() {});
+        this.latencyMs = Math.max(latencyMs, 0);
+        this.jitterMs = Math.max(jitterMs, 0);
+        this.failureRate = failureRate;
+    }
+
+    private static <T> T load(JsonMapper mapper, Path dir, String name, TypeReference<T> type) {
+        Path file = dir.resolve(name);
+        try (InputStream in = Files.exists(file) ? Files.newInputStream(file) : new ClassPathResource("replay/" + name).getInputStream()) {
+            return mapper.readValue(in, type);
+        } catch (IOException e) {
+            throw new UncheckedIOException("Cannot read recording " + name, e);
+        }
+    }
+
+    // Copy k gets route ids shifted by k * SCALE_ID_STRIDE so the lists stay consistent
+    private static List<TramOrientationService.Route> scaleRoutes(List<TramOrientationService.Route> recorded, int scale) {
+        List<TramOrientationService.Route> scaled = new ArrayList<>(recorded);
+        for (int k = 1; k < scale; k++) {
+            for (TramOrientationService.Route r : recorded) {
+                scaled.add(new TramOrientationService.Route(r.route_id() + k * SCALE_ID_STRIDE, r.route_short_name(),
+                        r.route_long_name(), r.route_type()));
+            }
+        }
+        return List.copyOf(scaled);
+    }
+
+    private static List<TramOrientationService.Trip> scaleTrips(List<TramOrientationService.Trip> recorded, int scale) {
+        List<TramOrientationService.Trip> scaled = new ArrayList<>(recorded);
+        for (int k = 1; k < scale; k++) {
+            for (TramOrientationService.Trip t : recorded) {
+                scaled.add(new TramOrientationService.Trip(t.trip_id() + "#" + k, t.route_id() + k * SCALE_ID_STRIDE,
+                        t.direction_id(), t.trip_headsign()));
+            }
+        }
+        return List.copyOf(scaled);
+    }
+
+    // A longer trip: copies continue the stop sequence
+    private static List<TramOrientationService.StationWithVehicle> scaleStations(List<TramOrientationService.StationWithVehicle> recorded, int scale) {
+        List<TramOrientationService.StationWithVehicle> scaled = new ArrayList<>(recorded);
+        for (int k = 1; k < scale; k++) {
+            for (TramOrientationService.StationWithVehicle s : recorded) {
+                scaled.add(new TramOrientationService.StationWithVehicle(s.sequence() + k * recorded.size(), s.stationName(),
+                        s.lat(), s.lon(), s.vehicles(), s.hasVehicle()));
+            }
+        }
+        return List.copyOf(scaled);
+    }
+
+    // Waits out the simulated latency, returns false when this request should fail
+    private boolean simulateNetwork() {
+        ThreadLocalRandom random = ThreadLocalRandom.current();
+        long delay = latencyMs + (jitterMs > 0 ? random.nextLong(-jitterMs, jitterMs + 1) : 0);
+        if (delay > 0) {
+            try {
+                Thread.sleep(delay);
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+            }
+        }
+        return random.nextDouble() >= failureRate;
+    }
+
+    private static <T> ResponseEntity<T> unavailable() {
+        return ResponseEntity.status(HttpStatus.SERVICE_UNAVAILABLE).header("Retry-After", RETRY_AFTER_S).build();
+    }
+
+    @GetMapping("/api/routes-with-vehicles")
+    public ResponseEntity<List<TramOrientationService.Route>> getRoutesWithVehicles(@RequestParam(required = false) Integer offset,
+                                                                                   @RequestParam(required = false) Integer limit,
+                                                                                   WebRequest request) {
+        if (!simulateNetwork()) return unavailable();
+        return TramController.catalogPage(routes, offset, limit, request, TramController::routeKey);
+    }
+
+    @GetMapping("/api/trips")
+    public ResponseEntity<List<TramOrientationService.Trip>> getTrips(@RequestParam(required = false) Integer routeId,
+                                                                     @RequestParam(required = false) Integer offset,
+                                                                     @RequestParam(required = false) Integer limit) {
+        if (!simulateNetwork()) return unavailable();
+        if (routeId != null) {
+            return TramController.page(trips.stream().filter(t -> routeId.equals(t.route_id())).toList(), offset, limit);
+        }
+        return TramController.page(trips, offset, limit);
+    }
+
+    @GetMapping("/api/stations-with-vehicles")
+    public ResponseEntity<List<TramOrientationService.StationWithVehicle>> getStationsWithVehicles(@RequestParam(required = false) String tripId,
+                                                                                                  @RequestParam(required = false) Integer offset,
+                                                                                                  @RequestParam(required = false) Integer limit,
+                                                                                                  WebRequest request) {
+        if (!simulateNetwork()) return unavailable();
+        return TramController.catalogPage(stations, offset, limit, request, TramController::stationKey);
+    }
+
+    @PostMapping("/api/user-location")
+    public ResponseEntity<String> setUserLocation(@RequestParam double lat, @RequestParam double lon, @RequestParam(required = false) String name) {
+        if (!simulateNetwork()) return unavailable();
+        return ResponseEntity.ok(name != null ? "User location set to: " + name : "User location set");
+    }
+
+    @GetMapping(value = "/api/vehicles/compact", produces = MediaType.APPLICATION_OCTET_STREAM_VALUE)
+    public ResponseEntity<byte[]> getCompactVehicles(@RequestParam(required = false) List<String> tripId) {
+        if (!simulateNetwork()) return unavailable();
+        if (tripId == null || tripId.isEmpty()) {
+            return ResponseEntity.ok(CompactVehicles.encode(List.of(vehicles), status.dataTimestamp()));
+        }
+        if (tripId.size() > CompactVehicles.MAX_TRIPS) {
+            return ResponseEntity.badRequest().build();
+        }
+        List<List<TramOrientationService.Vehicle>> onTrips = tripId.stream()
+                .map(id -> vehicles.stream().filter(v -> id.equals(v.trip_id())).toList())
+                .toList();
+        return ResponseEntity.ok(CompactVehicles.encode(onTrips, status.dataTimestamp()));
+    }
+
+    @GetMapping("/api/status")
+    public ResponseEntity<String> getStatus() {
+        if (!simulateNetwork()) return unavailable();
+        return ResponseEntity.ok(TramOrientationService.describeStatus(status));
+    }
+
+    @GetMapping(value = "/api/status/compact", produces = MediaType.APPLICATION_OCTET_STREAM_VALUE)
+    public ResponseEntity<byte[]> getCompactStatus() {
+        if (!simulateNetwork()) return unavailable();
+        return ResponseEntity.ok(CompactStatus.encode(status));
+    }
+
+    @GetMapping(value = "/api/status/batch", produces = MediaType.APPLICATION_OCTET_STREAM_VALUE)
+    public ResponseEntity<byte[]> getStatusBatch(@RequestParam MultiValueMap<String, String> params) {
+        if (!simulateNetwork()) return unavailable();
+        List<TramOrientationService.Watch> watches = TramController.parseWatches(params);
+        if (watches == null) {
+            return ResponseEntity.badRequest().build();
+        }
+        return ResponseEntity.ok(CompactStatus.encodeBatch(watches.stream().map(w -> status).toList()));
+    }
+}
@@ -1,18 +1,43 @@
 package com.example.YouShouldGo;
 
 import org.springframework.beans.factory.annotation.Value;
+import org.springframework.context.annotation.Profile;
+import org.springframework.http.MediaType;
+import org.springframework.http.ResponseEntity;
+import org.springframework.util.DigestUtils;
+import org.springframework.util.MultiValueMap;
 import org.springframework.web.bind.annotation.*;
+import org.springframework.web.context.request.WebRequest;
+import org.springframework.web.servlet.mvc.method.annotation.SseEmitter;
 
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.Collections;
 import java.util.List;
 import java.util.Map;
+import java.util.function.Function;
+import java.util.stream.Collectors;
 
+// The live API, ReplayController stands in for it under the "replay" profile
 @RestController
+@Profile("!replay")
 public class TramController {
+    // Sent by every display, see TramOrientationService.Session
+    static final String DEVICE_HEADER = "X-Device-Id";
+
     private final TramOrientationService service;
+    private final TramStatusStream statusStream;
 
 
-    public TramController(TramOrientationService service) {
+    public TramController(TramOrientationService service, TramStatusStream statusStream) {
         this.service = service;
+        this.statusStream = statusStream;
+    }
+
+    // An unknown trip id selected by a device or the web page
+    @ExceptionHandler(IllegalArgumentException.class)
+    public ResponseEntity<String> badRequest(IllegalArgumentException e) {
+        return ResponseEntity.badRequest().body(e.getMessage());
     }
 
     @GetMapping("/api/agencies")
@@ -25,53 +50,174 @@ public class TramController {
         return service.getRoutes();
     }
 
+    // offset/limit select a page, X-Total-Count always carries the full size.
+    // Without limit the whole list is returned as before.
+    static <T> ResponseEntity<List<T>> page(List<T> list, Integer offset, Integer limit) {
+        int from = Math.min(Math.max(offset != null ? offset : 0, 0), list.size());
+        int to = limit != null ? Math.min(from + Math.max(limit, 0), list.size()) : list.size();
+        return ResponseEntity.ok()
+                .header("X-Total-Count", String.valueOf(list.size()))
+                .body(list.subList(from, to));
+    }
+
+    // Validator of a catalog page from its static fields only (catalogKey of
+    // each record, plus the list size), so live vehicle data in the body does
+    // not change it and a device's cached copy revalidates with a 304.
+    static <T> String catalogETag(List<T> page, int total, Function<T, String> catalogKey) {
+        String keys = total + "\n" + page.stream().map(catalogKey).collect(Collectors.joining("\n"));
+        return "\"" + DigestUtils.md5DigestAsHex(keys.getBytes(StandardCharsets.UTF_8)) + "\"";
+    }
+
+    // page() with a catalogETag(), null once a matching If-None-Match has been answered with 304
+    static <T> ResponseEntity<List<T>> catalogPage(List<T> list, Integer offset, Integer limit, WebRequest request,
+                                                   Function<T, String> catalogKey) {
+        ResponseEntity<List<T>> page = page(list, offset, limit);
+        String etag = catalogETag(page.getBody(), list.size(), catalogKey);
+        if (request.checkNotModified(etag)) {
+            return null;
+        }
+        return ResponseEntity.ok().headers(page.getHeaders()).eTag(etag).body(page.getBody());
+    }
+
+    static String routeKey(TramOrientationService.Route route) {
+        return route.toString();
+    }
+
+    // hasVehicle and vehicles are live, they are left out
+    static String stationKey(TramOrientationService.StationWithVehicle station) {
+        return station.sequence() + "," + station.stationName() + "," + station.lat() + "," + station.lon();
+    }
+
     @GetMapping("/api/routes-with-vehicles")
-    public List<TramOrientationService.Route> getRoutesWithVehicles() {
-        return service.getRoutesWithVehicles();
+    public ResponseEntity<List<TramOrientationService.Route>> getRoutesWithVehicles(@RequestParam(required = false) Integer offset,
+                                                                                   @RequestParam(required = false) Integer limit,
+                                                                                   WebRequest request) {
+        return catalogPage(service.getRoutesWithVehicles(), offset, limit, request, TramController::routeKey);
     }
 
     @GetMapping("/api/trips")
-    public List<TramOrientationService.Trip> getTrips(@RequestParam(required = false) Integer routeId) {
+    public ResponseEntity<List<TramOrientationService.Trip>> getTrips(@RequestParam(required = false) Integer routeId,
+                                                                     @RequestParam(required = false) Integer offset,
+                                                                     @RequestParam(required = false) Integer limit) {
         if (routeId != null) {
-            return service.getTripsForRoute(routeId);
+            return page(service.getTripsForRoute(routeId), offset, limit);
         }
-        return service.getTrips();
+        return page(service.getTrips(), offset, limit);
     }
     
 
     @PostMapping("/api/trips/select")
-    public String selectTrip(@RequestParam String tripId) {
-        service.setSelectedTrip(tripId);
+    public String selectTrip(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId,
+                             @RequestParam String tripId) {
+        service.setSelectedTrip(service.getSession(deviceId), tripId);
         return "Selected trip: " + tripId;
     }
 
+    // With tripId the trip is selected first, so a device sets up its whole session in one request
     @PostMapping("/api/user-location")
-    public String setUserLocation(@RequestParam double lat, @RequestParam double lon, @RequestParam(required = false) String name) {
-        service.setUserLocation(lat, lon, name);
+    public String setUserLocation(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId,
+                                  @RequestParam double lat, @RequestParam double lon,
+                                  @RequestParam(required = false) String name,
+                                  @RequestParam(required = false) String tripId) {
+        TramOrientationService.Session session = service.getSession(deviceId);
+        if (tripId != null && !tripId.isEmpty() && !tripId.equals(session.getSelectedTrip())) {
+            service.setSelectedTrip(session, tripId);
+        }
+        service.setUserLocation(session, lat, lon, name);
         return name != null ? "User location set to: " + name : "User location set";
     }
 
     @GetMapping("/api/trips/selected")
-    public String getSelectedTrip() {
-        return service.getSelectedTrip();
+    public String getSelectedTrip(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId) {
+        return service.getSession(deviceId).getSelectedTrip();
     }
 
     @GetMapping("/api/map")
-    public Map<Integer, TramOrientationService.StopLocation> getMap() {
-        return service.getTripMap();
+    public Map<Integer, TramOrientationService.StopLocation> getMap(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId) {
+        return service.getTripMap(service.getSession(deviceId));
     }
     @GetMapping("/api/vehicles")
-    public List<TramOrientationService.Vehicle> getLiveVehicles() {
-        return service.getRouteVehicles();
+    public List<TramOrientationService.Vehicle> getLiveVehicles(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId) {
+        return service.getRouteVehicles(service.getSession(deviceId));
+    }
+
+    // Positions only, the device computes its status from them. One tripId
+    // per watched trip, each record carries its index. Without tripId the
+    // session's trip is used, the one /api/stations-with-vehicles lists.
+    @GetMapping(value = "/api/vehicles/compact", produces = MediaType.APPLICATION_OCTET_STREAM_VALUE)
+    public ResponseEntity<byte[]> getCompactVehicles(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId,
+                                                     @RequestParam(required = false) List<String> tripId) {
+        List<String> tripIds = tripId != null && !tripId.isEmpty() ? tripId
+                : Collections.singletonList(service.getSession(deviceId).getSelectedTrip());
+        if (tripIds.size() > CompactVehicles.MAX_TRIPS) {
+            return ResponseEntity.badRequest().build();
+        }
+        List<List<TramOrientationService.Vehicle>> vehicles = tripIds.stream().map(service::getVehiclesForTrip).toList();
+        return ResponseEntity.ok(CompactVehicles.encode(vehicles, service.getVehiclesTimestamp()));
     }
     
     @GetMapping("/api/stations-with-vehicles")
-    public List<TramOrientationService.StationWithVehicle> getStationsWithVehicles() {
-        return service.getStationsWithVehicles();
+    public ResponseEntity<List<TramOrientationService.StationWithVehicle>> getStationsWithVehicles(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId,
+                                                                                                  @RequestParam(required = false) String tripId,
+                                                                                                  @RequestParam(required = false) Integer offset,
+                                                                                                  @RequestParam(required = false) Integer limit,
+                                                                                                  WebRequest request) {
+        List<TramOrientationService.StationWithVehicle> stations = tripId == null || tripId.isEmpty()
+                ? service.getStationsWithVehicles(service.getSession(deviceId)) : service.getStationsWithVehicles(tripId);
+        return catalogPage(stations, offset, limit, request, TramController::stationKey);
     }
     
     @GetMapping("/api/status")
-    public String getStatus() {
-        return service.getTramStatusForESP32();
+    public String getStatus(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId) {
+        return service.getTramStatusForESP32(service.getSession(deviceId));
+    }
+
+    // Fixed CompactStatus.SIZE byte payload for the device
+    @GetMapping(value = "/api/status/compact", produces = MediaType.APPLICATION_OCTET_STREAM_VALUE)
+    public byte[] getCompactStatus(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId) {
+        return CompactStatus.encode(service.getTramStatus(service.getSession(deviceId)));
+    }
+
+    // watch=tripId,lat,lon values, at most CompactStatus.MAX_BATCH. Read from
+    // the raw parameters since a List<String> would be split on the commas.
+    // null when one is malformed or there are too many.
+    static List<TramOrientationService.Watch> parseWatches(MultiValueMap<String, String> params) {
+        List<String> values = params.getOrDefault("watch", List.of());
+        if (values.size() > CompactStatus.MAX_BATCH) {
+            return null;
+        }
+
+        List<TramOrientationService.Watch> watches = new ArrayList<>();
+        for (String value : values) {
+            // From the right, a trip id may itself hold commas
+            int lonAt = value.lastIndexOf(',');
+            int latAt = lonAt > 0 ? value.lastIndexOf(',', lonAt - 1) : -1;
+            if (latAt <= 0) {
+                return null;
+            }
+            try {
+                watches.add(new TramOrientationService.Watch(value.substring(0, latAt),
+                        Double.parseDouble(value.substring(latAt + 1, lonAt)), Double.parseDouble(value.substring(lonAt + 1))));
+            } catch (NumberFormatException e) {
+                return null;
+            }
+        }
+        return watches;
+    }
+
+    // Every stop of a device's watchlist in one request, see CompactStatus.encodeBatch
+    @GetMapping(value = "/api/status/batch", produces = MediaType.APPLICATION_OCTET_STREAM_VALUE)
+    public ResponseEntity<byte[]> getStatusBatch(@RequestParam MultiValueMap<String, String> params) {
+        List<TramOrientationService.Watch> watches = parseWatches(params);
+        if (watches == null) {
+            return ResponseEntity.badRequest().build();
+        }
+        return ResponseEntity.ok(CompactStatus.encodeBatch(watches.stream().map(service::getWatchStatus).toList()));
+    }
+
+    @GetMapping(value = "/api/status/stream", produces = MediaType.TEXT_EVENT_STREAM_VALUE)
+    public SseEmitter streamStatus(@RequestHeader(value = DEVICE_HEADER, required = false) String deviceId,
+                                   @RequestHeader(value = "Last-Event-ID", required = false) String lastEventId) {
+        return statusStream.subscribe(deviceId, lastEventId);
     }
 }
\ No newline at end of file
@@ -7,11 +7,16 @@ import org.springframework.core.ParameterizedTypeReference;
 import org.springframework.stereotype.Service;
 import org.springframework.web.client.RestClient;
 
+import java.util.Collections;
 import java.util.Comparator;
 import java.util.HashMap;
+import java.util.LinkedHashMap;
 import java.util.List;
 import java.util.Map;
+import java.util.Objects;
 import java.util.Set;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.CompletionException;
 import java.util.stream.Collectors;
 
 @Service
@@ -20,16 +25,33 @@ public class TramOrientationService {
     @Value("${key}")
     String key; //api key from env
 
-    @Getter
-    private String selectedTrip; // Currently selected trip by user
-    
     @Getter
     private String selectedAgency = "2"; // Hardcodat to Cluj (agency_id=2) - API key restriction
 
-    private Double userLat;
-    private Double userLon;
-    @Getter
-    private String userStopName;
+    // What one display (or the web page) selected. Each device sends its own
+    // id, requests without one share DEFAULT_DEVICE.
+    public static final class Session {
+        @Getter
+        private String selectedTrip; // Currently selected trip by user
+        private Double userLat;
+        private Double userLon;
+        @Getter
+        private String userStopName;
+
+        private TramStatus lastTramStatus;
+        // Starts from the boot time so a device holding a seq from before a restart still sees a change
+        private long statusSeq = System.currentTimeMillis() / 1000;
+    }
+
+    public static final String DEFAULT_DEVICE = "default";
+    private static final int MAX_SESSIONS = 256; // least recently used ones are dropped, a device reselects on its next boot
+
+    private final Map<String, Session> sessions = Collections.synchronizedMap(new LinkedHashMap<>(16, 0.75f, true) {
+        @Override
+        protected boolean removeEldestEntry(Map.Entry<String, Session> eldest) {
+            return size() > MAX_SESSIONS;
+        }
+    });
 
     public record Agency(Integer agency_id, String agency_name, String agency_url, String agency_timezone) {} //api data: transit agency information
     public record Route(Integer route_id, String route_short_name, String route_long_name, Integer route_type) {} //api data: route information (e.g., "7" tram line)
@@ -40,21 +62,128 @@ public class TramOrientationService {
     public record StopLocation(String name, Double lat, Double lon, int sequence) {}//agregate stop info for easy access: name, geolocation, and sequence in the trip
     public record StationWithVehicle(int sequence, String stationName, Double lat, Double lon, List<VehicleInfo> vehicles, int hasVehicle) {}
     public record VehicleInfo(Integer id, String label, Double speed) {}
+    public record VehicleApproach(Integer vehicleId, int stopsAway) {} //a vehicle still coming towards the user's stop
+    public record TramStatus(int state, List<VehicleApproach> approaching, long dataTimestamp, long seq) {} //structured status, approaching is sorted nearest first
+    public record Watch(String tripId, double lat, double lon) {} //a stop a device tracks on a trip, without selecting it
+
+    // TramStatus.state values, shared with the firmware (compactstatus.h)
+    public static final int STATUS_NO_TRIP = 0;
+    public static final int STATUS_NO_STATION = 1;
+    public static final int STATUS_MAP_ERROR = 2;
+    public static final int STATUS_APPROACHING = 3;
+    public static final int STATUS_ALL_PASSED = 4;
+    public static final int MAX_APPROACHING = 4;
 
     private final RestClient restClient;
 
-    @Getter
-    private final Map<Integer, StopLocation> tripMap = new HashMap<>();
+    // Stops of the trips asked for recently, by trip id, shared by all the
+    // sessions and watchlists on that trip. stop_times is far too large to
+    // fetch per request, so a trip is only reloaded after TRIP_STOPS_MAX_AGE_MS.
+    // The ids come from devices, so only the agency's own trips are loaded and
+    // the least recently used past MAX_TRIP_STOPS are dropped. Each entry holds
+    // its load as a future, the download runs outside the map's lock and
+    // concurrent requests for the same trip wait for that one download.
+    private record CachedStops(CompletableFuture<Map<Integer, StopLocation>> stops, long loadedAt) {}
+    private static final long TRIP_STOPS_MAX_AGE_MS = 6 * 60 * 60 * 1000L;
+    private static final int MAX_TRIP_STOPS = 64;
+    private final Map<String, CachedStops> tripStops = new LinkedHashMap<>(16, 0.75f, true) {
+        @Override
+        protected boolean removeEldestEntry(Map.Entry<String, CachedStops> eldest) {
+            return size() > MAX_TRIP_STOPS;
+        }
+    };
+
+    // The agency's trip ids, refreshed with the same age as the stops
+    private Set<String> knownTripIds = Set.of();
+    private long knownTripIdsAt;
+    private final Object knownTripIdsLock = new Object();
+
+    // All of the agency's vehicles, shared by every request for VEHICLES_MAX_AGE_MS
+    private static final long VEHICLES_MAX_AGE_MS = 2000;
+    private List<Vehicle> agencyVehicles;
+    private long agencyVehiclesAt;
 
     public TramOrientationService(RestClient restClient) {
         this.restClient = restClient;
     }
-    //ordered list of all stops on the route with their physical locations.
-    public void buildMapForTrip(String tripId) {
+    // null or blank ids are the web page and older firmware
+    public static String deviceKey(String deviceId) {
+        return deviceId == null || deviceId.isBlank() ? DEFAULT_DEVICE : deviceId;
+    }
+
+    public Session getSession(String deviceId) {
+        return sessions.computeIfAbsent(deviceKey(deviceId), id -> new Session());
+    }
+
+    private Session defaultSession() {
+        return getSession(DEFAULT_DEVICE);
+    }
+
+    // Stops of any of the agency's trips, loaded once and then served from
+    // memory. Unknown trip ids get no stops and nothing is downloaded for them.
+    public Map<Integer, StopLocation> getStopsForTrip(String tripId) {
+        if (tripId == null || !isKnownTrip(tripId)) {
+            return Map.of();
+        }
+
+        long now = System.currentTimeMillis();
+        CachedStops entry;
+        boolean load = false;
+        synchronized (tripStops) {
+            entry = tripStops.get(tripId);
+            if (entry == null || now - entry.loadedAt() >= TRIP_STOPS_MAX_AGE_MS) {
+                entry = new CachedStops(new CompletableFuture<>(), now);
+                tripStops.put(tripId, entry);
+                load = true;
+            }
+        }
+
+        if (load) {
+            try {
+                entry.stops().complete(loadStopsForTrip(tripId));
+            } catch (RuntimeException e) {
+                // Not cached, the next request tries again
+                synchronized (tripStops) {
+                    tripStops.remove(tripId, entry);
+                }
+                entry.stops().completeExceptionally(e);
+                throw e;
+            }
+        }
+
+        try {
+            return entry.stops().join();
+        } catch (CompletionException e) {
+            throw e.getCause() instanceof RuntimeException cause ? cause : e;
+        }
+    }
+
+    public boolean isKnownTrip(String tripId) {
+        synchronized (knownTripIdsLock) {
+            long now = System.currentTimeMillis();
+            if (knownTripIdsAt == 0 || now - knownTripIdsAt >= TRIP_STOPS_MAX_AGE_MS) {
+                knownTripIds = getTrips().stream().map(Trip::trip_id).filter(Objects::nonNull).collect(Collectors.toUnmodifiableSet());
+                knownTripIdsAt = now;
+            }
+            return knownTripIds.contains(tripId);
+        }
+    }
+
+    //ordered list of all stops on the session's trip with their physical locations.
+    public Map<Integer, StopLocation> getTripMap(Session session) {
+        String trip = session.getSelectedTrip();
+        return trip == null || trip.isEmpty() ? Map.of() : getStopsForTrip(trip);
+    }
+
+    public Map<Integer, StopLocation> getTripMap() {
+        return getTripMap(defaultSession());
+    }
+
+    private Map<Integer, StopLocation> loadStopsForTrip(String tripId) {
         if (selectedAgency == null || selectedAgency.isEmpty()) {
             throw new IllegalStateException("Please select an agency first using POST /api/agencies/select?agencyId=X");
         }
-        tripMap.clear(); // Clear existing data
+        Map<Integer, StopLocation> stops = new HashMap<>();
         var spec1 = (RestClient.RequestHeadersSpec<?>) restClient.get()
                 .uri("https://api.tranzy.ai/v1/opendata/stop_times")
                 .headers(h -> { h.add("X-API-KEY", key); h.add("X-Agency-Id", selectedAgency); });
@@ -85,13 +214,14 @@ public class TramOrientationService {
             allStops.stream()
                     .filter(s -> s.stop_id().equals(id))
                     .findFirst()
-                    .ifPresent(s -> tripMap.put(id, new StopLocation(
+                    .ifPresent(s -> stops.put(id, new StopLocation(
                             s.stop_name(),
                             s.stop_lat(),
                             s.stop_lon(),
                             sequence
                     )));
         }
+        return Map.copyOf(stops);
     }
 
     public List<Agency> getAgencies() {
@@ -124,10 +254,7 @@ public class TramOrientationService {
         }
 
         // Get all vehicles
-        var vehicleSpec = (RestClient.RequestHeadersSpec<?>) restClient.get()
-                .uri("https://api.tranzy.ai/v1/opendata/vehicles")
-                .headers(h -> { h.add("X-API-KEY", key); h.add("X-Agency-Id", selectedAgency); });
-        List<Vehicle> allVehicles = vehicleSpec.retrieve().body(new ParameterizedTypeReference<List<Vehicle>>() {});
+        List<Vehicle> allVehicles = getAgencyVehicles();
 
         // Get all trips to map trip_id to route_id
         List<Trip> allTrips = getTrips();
@@ -166,90 +293,202 @@ public class TramOrientationService {
                 .toList();
     }
 
+    public void setSelectedTrip(Session session, String tripId) {
+        // Resolved before the session is locked, so a bad trip fails the selection
+        // and not every status after it, and a slow load blocks no other request
+        if (tripId == null || !isKnownTrip(tripId)) {
+            throw new IllegalArgumentException("Unknown trip: " + tripId);
+        }
+        getStopsForTrip(tripId);
+        synchronized (session) {
+            session.selectedTrip = tripId;
+            session.userLat = null;
+            session.userLon = null;
+            session.userStopName = null;
+        }
+    }
+
     public void setSelectedTrip(String tripId) {
-        this.selectedTrip = tripId;
-        this.userLat = null;
-        this.userLon = null;
-        this.userStopName = null;
-        // Rebuild the map for the new trip
-        buildMapForTrip(tripId);
+        setSelectedTrip(defaultSession(), tripId);
+    }
+
+    public void setUserLocation(Session session, double lat, double lon, String stopName) {
+        synchronized (session) {
+            session.userLat = lat;
+            session.userLon = lon;
+            session.userStopName = stopName;
+        }
     }
 
     public void setUserLocation(double lat, double lon, String stopName) {
-        this.userLat = lat;
-        this.userLon = lon;
-        this.userStopName = stopName;
+        setUserLocation(defaultSession(), lat, lon, stopName);
+    }
+
+    public String getSelectedTrip() {
+        return defaultSession().getSelectedTrip();
+    }
+
+    public String getUserStopName() {
+        return defaultSession().getUserStopName();
+    }
+
+    public List<Vehicle> getRouteVehicles(Session session) {
+        return getVehiclesForTrip(session.getSelectedTrip());
     }
 
     public List<Vehicle> getRouteVehicles() {
+        return getRouteVehicles(defaultSession());
+    }
+
+    // Vehicles with a position on tripId, from the shared agency snapshot
+    public List<Vehicle> getVehiclesForTrip(String tripId) {
         if (selectedAgency == null || selectedAgency.isEmpty()) {
             throw new IllegalStateException("Please select an agency first using POST /api/agencies/select?agencyId=X");
         }
         
-        if (selectedTrip == null || selectedTrip.isEmpty()) {
+        if (tripId == null || tripId.isEmpty()) {
             return List.of(); // Return empty list if no trip selected yet
         }
-        
+
+        return getAgencyVehicles().stream()
+                .filter(v -> tripId.equals(v.trip_id()) && v.latitude() != null && v.longitude() != null)
+                .toList();
+    }
+
+    // Unix seconds when the vehicle snapshot was taken, 0 before the first one
+    public synchronized long getVehiclesTimestamp() {
+        return agencyVehiclesAt / 1000;
+    }
+
+    // Polling devices and the status stream all read the same snapshot, so
+    // Tranzy is asked at most once per VEHICLES_MAX_AGE_MS
+    private synchronized List<Vehicle> getAgencyVehicles() {
+        long now = System.currentTimeMillis();
+        if (agencyVehicles != null && now - agencyVehiclesAt < VEHICLES_MAX_AGE_MS) {
+            return agencyVehicles;
+        }
+
         var spec = (RestClient.RequestHeadersSpec<?>) restClient.get()
                 .uri("https://api.tranzy.ai/v1/opendata/vehicles")
                 .headers(h -> { h.add("X-API-KEY", key); h.add("X-Agency-Id", selectedAgency); });
 
-        List<Vehicle> all = spec.retrieve().body(new ParameterizedTypeReference<List<Vehicle>>() {});
+        agencyVehicles = spec.retrieve().body(new ParameterizedTypeReference<List<Vehicle>>() {});
+        agencyVehiclesAt = now;
+        return agencyVehicles;
+    }
 
-        // Use selectedTrip if set
-        String activeTripId = selectedTrip;
-        return all.stream()
-                .filter(v -> activeTripId.equals(v.trip_id()) && v.latitude() != null && v.longitude() != null)
-                .toList();
+    public String getTramStatusForESP32(Session session) {
+        return describeStatus(getTramStatus(session));
     }
 
     public String getTramStatusForESP32() {
-        if (selectedTrip == null || selectedTrip.isEmpty()) {
-            return "Please select a trip first";
-        }
-        
-        if (userLat == null || userLon == null) {
-            return "Please select your station first";
+        return getTramStatusForESP32(defaultSession());
+    }
+
+    // Text form of a status, as shown by older firmware
+    public static String describeStatus(TramStatus status) {
+        switch (status.state()) {
+            case STATUS_NO_TRIP:
+                return "Please select a trip first";
+            case STATUS_NO_STATION:
+                return "Please select your station first";
+            case STATUS_MAP_ERROR:
+                return "Map Error, hashmap not built";
+            case STATUS_ALL_PASSED:
+                return "all vehicles passed your stop";
+            default:
+                int minStopsAway = status.approaching().get(0).stopsAway();
+                if (minStopsAway == 1) return "Next Stop";
+                if (minStopsAway == 0) return "In Station";
+                return minStopsAway + " stops away";
         }
+    }
 
-        // Get all stations with their vehicle positions
-        List<StationWithVehicle> stations = getStationsWithVehicles();
-        
-        if (stations.isEmpty()) {
-            return "Map Error, hashmap not built";
+    // Nearest MAX_APPROACHING vehicles coming towards the user's stop. seq only
+    // changes when state or the approaching list does, not with the timestamp.
+    // The stations are fetched outside the session's lock, it only guards the
+    // selection and seq
+    public TramStatus getTramStatus(Session session) {
+        String trip;
+        Double lat;
+        Double lon;
+        synchronized (session) {
+            trip = session.selectedTrip;
+            lat = session.userLat;
+            lon = session.userLon;
         }
 
-        // Find user's current station
-        StationWithVehicle userStation = stations.stream()
-            .min(Comparator.comparingDouble(s -> 
-                calculateDistance(userLat, userLon, s.lat(), s.lon())))
-            .orElse(null);
+        int state;
+        List<VehicleApproach> approaching = List.of();
+
+        if (trip == null || trip.isEmpty()) {
+            state = STATUS_NO_TRIP;
+        } else if (lat == null || lon == null) {
+            state = STATUS_NO_STATION;
+        } else {
+            // Get all stations with their vehicle positions
+            List<VehicleApproach> found = approachingAt(getStationsWithVehicles(trip), lat, lon);
+
+            if (found == null) {
+                state = STATUS_MAP_ERROR;
+            } else {
+                approaching = found;
+                state = approaching.isEmpty() ? STATUS_ALL_PASSED : STATUS_APPROACHING;
+            }
+        }
 
-        if (userStation == null) {
-            return "Map Error, hashmap not built";
+        synchronized (session) {
+            TramStatus last = session.lastTramStatus;
+            if (last == null || last.state() != state || !last.approaching().equals(approaching)) {
+                session.statusSeq++;
+            }
+            session.lastTramStatus = new TramStatus(state, approaching, System.currentTimeMillis() / 1000, session.statusSeq);
+            return session.lastTramStatus;
         }
+    }
 
-        // Find closest tram coming towards user
-        int minStopsAway = Integer.MAX_VALUE;
+    public TramStatus getTramStatus() {
+        return getTramStatus(defaultSession());
+    }
 
-        for (StationWithVehicle station : stations) {
-            if (station.hasVehicle() == 1) {
-                int stopsAway = userStation.sequence() - station.sequence();
-                
-                // Check if tram is coming (before user's station)
-                if (stopsAway >= 0 && stopsAway < minStopsAway) {
-                    minStopsAway = stopsAway;
-                }
-            }
+    // Status of a watched stop, for /api/status/batch. Nothing is kept between
+    // requests, so seq is a hash of state and approaching list: it changes
+    // when they do, like getTramStatus()'s.
+    public TramStatus getWatchStatus(Watch watch) {
+        List<VehicleApproach> approaching = approachingAt(getStationsWithVehicles(watch.tripId()), watch.lat(), watch.lon());
+
+        int state;
+        if (approaching == null) {
+            state = STATUS_MAP_ERROR;
+            approaching = List.of();
+        } else {
+            state = approaching.isEmpty() ? STATUS_ALL_PASSED : STATUS_APPROACHING;
         }
+        long seq = Integer.toUnsignedLong(Objects.hash(state, approaching));
+        return new TramStatus(state, approaching, getVehiclesTimestamp(), seq);
+    }
 
-        if (minStopsAway != Integer.MAX_VALUE) {
-            if (minStopsAway == 1) return "Next Stop";
-            if (minStopsAway == 0) return "In Station";
-            return minStopsAway + " stops away";
+    // Vehicles still coming towards the station nearest lat/lon, nearest first.
+    // null when the trip has no stations.
+    private List<VehicleApproach> approachingAt(List<StationWithVehicle> stations, double lat, double lon) {
+        // Find user's current station
+        StationWithVehicle userStation = stations.stream()
+            .min(Comparator.comparingDouble(s ->
+                calculateDistance(lat, lon, s.lat(), s.lon())))
+            .orElse(null);
+
+        if (userStation == null) {
+            return null;
         }
 
-        return "all vehicles passed your stop";
+        // Trams before the user's station are still coming
+        return stations.stream()
+            .filter(s -> s.hasVehicle() == 1 && userStation.sequence() - s.sequence() >= 0)
+            .flatMap(s -> s.vehicles().stream()
+                .map(v -> new VehicleApproach(v.id(), userStation.sequence() - s.sequence())))
+            .sorted(Comparator.comparingInt(VehicleApproach::stopsAway))
+            .limit(MAX_APPROACHING)
+            .toList();
     }
 
     private double calculateDistance(double lat1, double lon1, double lat2, double lon2) {
@@ -262,18 +501,33 @@ public class TramOrientationService {
         return R * 2 * Math.atan2(Math.sqrt(a), Math.sqrt(1 - a));
     }
 
-    public List<StationWithVehicle> getStationsWithVehicles() {
-        if (selectedTrip == null || selectedTrip.isEmpty() || tripMap.isEmpty()) {
+    public List<StationWithVehicle> getStationsWithVehicles(Session session) {
+        String trip = session.getSelectedTrip();
+        if (trip == null || trip.isEmpty()) {
             return List.of(); // Return empty list if no trip selected yet
         }
-        
-        List<Vehicle> vehicles = getRouteVehicles();
-        
+
+        return getStationsWithVehicles(trip);
+    }
+
+    public List<StationWithVehicle> getStationsWithVehicles() {
+        return getStationsWithVehicles(defaultSession());
+    }
+
+    // Any trip's stations, without selecting it. Without tripId the default session's trip.
+    public List<StationWithVehicle> getStationsWithVehicles(String tripId) {
+        if (tripId == null || tripId.isEmpty()) {
+            return getStationsWithVehicles();
+        }
+        return stationsWithVehicles(getStopsForTrip(tripId), getVehiclesForTrip(tripId));
+    }
+
+    private List<StationWithVehicle> stationsWithVehicles(Map<Integer, StopLocation> stops, List<Vehicle> vehicles) {
         // Map each vehicle to its closest station
         Map<Integer, List<VehicleInfo>> vehiclesByStation = new HashMap<>();
         
         for (Vehicle vehicle : vehicles) {
-            StopLocation closestStop = tripMap.values().stream()
+            StopLocation closestStop = stops.values().stream()
                 .min(Comparator.comparingDouble(s -> 
                     calculateDistance(vehicle.latitude(), vehicle.longitude(), s.lat(), s.lon())))
                 .orElse(null);
@@ -285,7 +539,7 @@ public class TramOrientationService {
         }
         
         // Create StationWithVehicle for each station
-        return tripMap.values().stream()
+        return stops.values().stream()
             .sorted(Comparator.comparingInt(StopLocation::sequence))
             .map(stop -> {
                 List<VehicleInfo> stationVehicles = vehiclesByStation.getOrDefault(stop.sequence(), List.of());
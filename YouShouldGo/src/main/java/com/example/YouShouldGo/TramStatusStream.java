@@ -0,0 +1,133 @@
+package com.example.YouShouldGo;
+
+import org.springframework.scheduling.annotation.Scheduled;
+import org.springframework.stereotype.Service;
+import org.springframework.web.servlet.mvc.method.annotation.SseEmitter;
+
+import java.io.IOException;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.CopyOnWriteArrayList;
+
+// Pushes each device its session's status, only when it changes. Events
+// carry the hex encoded CompactStatus and use its seq as the event id.
+@Service
+public class TramStatusStream {
+
+    private static final long EMITTER_TIMEOUT_MS = 30 * 60 * 1000L; // devices reconnect with Last-Event-ID
+    private static final long RECONNECT_MS = 3000;
+
+    private final TramOrientationService service;
+    // Subscribers and the status they were last sent, by device
+    private static final class Subscribers {
+        final List<SseEmitter> emitters = new CopyOnWriteArrayList<>();
+        volatile TramOrientationService.TramStatus lastStatus;
+    }
+
+    private final Map<String, Subscribers> devices = new ConcurrentHashMap<>();
+
+    public TramStatusStream(TramOrientationService service) {
+        this.service = service;
+    }
+
+    public SseEmitter subscribe(String deviceId, String lastEventId) {
+        String device = TramOrientationService.deviceKey(deviceId);
+        SseEmitter emitter = new SseEmitter(EMITTER_TIMEOUT_MS);
+        emitter.onCompletion(() -> drop(device, emitter));
+        emitter.onTimeout(emitter::complete);
+        emitter.onError(e -> drop(device, emitter));
+
+        // Joined under the map's lock so a concurrent drop() cannot discard the entry in between
+        boolean[] wasEmpty = new boolean[1];
+        Subscribers subscribers = devices.compute(device, (d, s) -> {
+            if (s == null) {
+                s = new Subscribers();
+            }
+            wasEmpty[0] = s.emitters.isEmpty();
+            s.emitters.add(emitter);
+            return s;
+        });
+        if (wasEmpty[0]) {
+            refresh(device, subscribers, emitter); // nobody was listening, lastStatus may be stale
+        }
+
+        // A reconnecting device that already has the current event gets nothing until the next change
+        TramOrientationService.TramStatus status = subscribers.lastStatus;
+        if (status != null && !String.valueOf(status.seq()).equals(lastEventId)) {
+            send(device, emitter, status);
+        }
+        return emitter;
+    }
+
+    // Every session's status comes from the same vehicle snapshot, so this
+    // costs one Tranzy request per tick however many devices listen
+    @Scheduled(fixedDelay = 2000)
+    public void poll() {
+        devices.forEach((device, subscribers) -> {
+            if (!subscribers.emitters.isEmpty()) {
+                refresh(device, subscribers, null);
+            }
+        });
+    }
+
+    // Comment lines keep proxies from closing an idle stream
+    @Scheduled(fixedRate = 15000)
+    public void heartbeat() {
+        devices.forEach((device, subscribers) -> {
+            for (SseEmitter emitter : subscribers.emitters) {
+                try {
+                    emitter.send(SseEmitter.event().comment("keep-alive"));
+                } catch (IOException e) {
+                    drop(device, emitter);
+                    emitter.completeWithError(e);
+                }
+            }
+        });
+    }
+
+    // The joining emitter is left to subscribe(), which honours its Last-Event-ID
+    private void refresh(String device, Subscribers subscribers, SseEmitter joining) {
+        synchronized (subscribers) {
+            TramOrientationService.TramStatus status;
+            try {
+                status = service.getTramStatus(service.getSession(device));
+            } catch (RuntimeException e) {
+                return; // upstream API hiccup, keep the last status and try again next tick
+            }
+
+            TramOrientationService.TramStatus last = subscribers.lastStatus;
+            if (last != null && status.seq() == last.seq()) {
+                return;
+            }
+            subscribers.lastStatus = status;
+
+            for (SseEmitter emitter : subscribers.emitters) {
+                if (emitter != joining) {
+                    send(device, emitter, status);
+                }
+            }
+        }
+    }
+
+    // Forgets a closed stream, and the device with its last one so the map only holds listeners
+    private void drop(String device, SseEmitter emitter) {
+        devices.computeIfPresent(device, (d, s) -> {
+            s.emitters.remove(emitter);
+            return s.emitters.isEmpty() ? null : s;
+        });
+    }
+
+    private void send(String device, SseEmitter emitter, TramOrientationService.TramStatus status) {
+        try {
+            emitter.send(SseEmitter.event()
+                    .id(String.valueOf(status.seq()))
+                    .name("status")
+                    .reconnectTime(RECONNECT_MS)
+                    .data(CompactStatus.encodeHex(status)));
+        } catch (IOException e) {
+            drop(device, emitter);
+            emitter.completeWithError(e);
+        }
+    }
+}
@@ -2,10 +2,14 @@ package com.example.YouShouldGo;
 
 import org.springframework.boot.SpringApplication;
 import org.springframework.boot.autoconfigure.SpringBootApplication;
+import org.springframework.boot.web.servlet.FilterRegistrationBean;
 import org.springframework.context.annotation.Bean;
+import org.springframework.scheduling.annotation.EnableScheduling;
 import org.springframework.web.client.RestClient;
+import org.springframework.web.filter.ShallowEtagHeaderFilter;
 
 @SpringBootApplication
+@EnableScheduling
 public class YouShouldGoApplication {
 
     public static void main(String[] args) {
@@ -16,4 +20,13 @@ public class YouShouldGoApplication {
     public RestClient restClient() {
         return RestClient.create();
     }
+
+    // ETag on the trips catalog so devices can revalidate their cached copies (If-None-Match -> 304).
+    // Routes and stations carry live vehicle data, their controllers hash only the static fields.
+    @Bean
+    public FilterRegistrationBean<ShallowEtagHeaderFilter> catalogEtagFilter() {
+        FilterRegistrationBean<ShallowEtagHeaderFilter> registration = new FilterRegistrationBean<>(new ShallowEtagHeaderFilter());
+        registration.addUrlPatterns("/api/trips");
+        return registration;
+    }
 }
\ No newline at end of file
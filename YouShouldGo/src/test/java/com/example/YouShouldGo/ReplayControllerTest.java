@@ -0,0 +1,98 @@
+package com.example.YouShouldGo;
+
+import org.junit.jupiter.api.Test;
+import org.springframework.http.HttpStatus;
+import org.springframework.http.ResponseEntity;
+import org.springframework.util.LinkedMultiValueMap;
+import tools.jackson.databind.json.JsonMapper;
+
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Tests for the replay backend, built directly on the bundled sample recordings
+ * (the directory given does not exist, so everything falls back to resources/replay).
+ */
+class ReplayControllerTest {
+
+    private static ReplayController replay(double failureRate, int payloadScale) {
+        return new ReplayController(JsonMapper.builder().build(), "does-not-exist", 0, 0, failureRate, payloadScale);
+    }
+
+    @Test
+    void testRoutesArePagedWithTotalCount() {
+        ResponseEntity<List<TramOrientationService.Route>> all = replay(0, 1).getRoutesWithVehicles(null, null);
+        int total = all.getBody().size();
+        assertTrue(total > 2);
+
+        ResponseEntity<List<TramOrientationService.Route>> page = replay(0, 1).getRoutesWithVehicles(1, 2);
+        assertEquals(2, page.getBody().size());
+        assertEquals(String.valueOf(total), page.getHeaders().getFirst("X-Total-Count"));
+        assertEquals(all.getBody().get(1), page.getBody().get(0));
+    }
+
+    @Test
+    void testTripsFilterByRoute() {
+        List<TramOrientationService.Trip> trips = replay(0, 1).getTrips(1, null, null).getBody();
+
+        assertFalse(trips.isEmpty());
+        assertTrue(trips.stream().allMatch(t -> t.route_id() == 1));
+    }
+
+    @Test
+    void testPayloadScaleRepeatsCatalogs() {
+        int routes = replay(0, 1).getRoutesWithVehicles(null, null).getBody().size();
+        List<TramOrientationService.StationWithVehicle> stations = replay(0, 1).getStationsWithVehicles(null, null).getBody();
+        ReplayController scaled = replay(0, 3);
+
+        assertEquals(3 * routes, scaled.getRoutesWithVehicles(null, null).getBody().size());
+        // Copies get their own route ids, so a route still only lists its own trips
+        assertEquals(replay(0, 1).getTrips(1, null, null).getBody().size(),
+                scaled.getTrips(1 + ReplayController.SCALE_ID_STRIDE, null, null).getBody().size());
+        List<TramOrientationService.StationWithVehicle> scaledStations = scaled.getStationsWithVehicles(null, null).getBody();
+        assertEquals(3 * stations.size(), scaledStations.size());
+        assertEquals(3 * stations.size(), scaledStations.get(scaledStations.size() - 1).sequence());
+    }
+
+    @Test
+    void testFailureRateOneAlwaysFails() {
+        ResponseEntity<List<TramOrientationService.Route>> response = replay(1, 1).getRoutesWithVehicles(null, null);
+
+        assertEquals(HttpStatus.SERVICE_UNAVAILABLE, response.getStatusCode());
+        assertNotNull(response.getHeaders().getFirst("Retry-After"));
+    }
+
+    @Test
+    void testStatusIsServedInBothForms() {
+        ReplayController controller = replay(0, 1);
+
+        assertEquals("3 stops away", controller.getStatus().getBody());
+        assertEquals(CompactStatus.SIZE, controller.getCompactStatus().getBody().length);
+    }
+
+    @Test
+    void testVehicleFeedFiltersByTrip() {
+        ReplayController controller = replay(0, 1);
+        byte[] all = controller.getCompactVehicles(null).getBody();
+
+        assertTrue(all[1] > 0);
+        assertEquals(CompactVehicles.HEADER_SIZE + all[1] * CompactVehicles.RECORD_SIZE, all.length);
+        assertEquals(0, controller.getCompactVehicles(List.of("no-such-trip")).getBody()[1]);
+        assertEquals(all[1], controller.getCompactVehicles(List.of("no-such-trip", "2_0")).getBody()[1]);
+    }
+
+    @Test
+    void testStatusBatchAnswersEveryWatch() {
+        LinkedMultiValueMap<String, String> params = new LinkedMultiValueMap<>();
+        params.add("watch", "2_0,46.766198,23.590152");
+        params.add("watch", "2_1,46.751002,23.559801");
+
+        byte[] batch = replay(0, 1).getStatusBatch(params).getBody();
+        assertEquals(2, batch[1]);
+        assertEquals(CompactStatus.BATCH_HEADER_SIZE + 2 * CompactStatus.SIZE, batch.length);
+
+        params.add("watch", "not-a-watch");
+        assertEquals(HttpStatus.BAD_REQUEST, replay(0, 1).getStatusBatch(params).getStatusCode());
+    }
+}
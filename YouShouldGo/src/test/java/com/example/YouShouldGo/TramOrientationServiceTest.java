@@ -4,7 +4,10 @@ import org.junit.jupiter.api.Test;
 import org.springframework.beans.factory.annotation.Autowired;
 import org.springframework.beans.factory.annotation.Value;
 import org.springframework.boot.test.context.SpringBootTest;
+import org.springframework.util.LinkedMultiValueMap;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.List;
 
 import static org.junit.jupiter.api.Assertions.*;
@@ -163,4 +166,156 @@ class TramOrientationServiceTest {
         assertNotNull(stations);
         assertTrue(stations.isEmpty());
     }
+
+    @Test
+    void testGetTramStatus_NoTripSelected_KeepsSeqWhileUnchanged() {
+        TramOrientationService.TramStatus first = service.getTramStatus();
+        TramOrientationService.TramStatus second = service.getTramStatus();
+
+        assertEquals(TramOrientationService.STATUS_NO_TRIP, first.state());
+        assertTrue(first.approaching().isEmpty());
+        assertEquals(first.seq(), second.seq());
+        assertEquals("Please select a trip first", service.getTramStatusForESP32());
+    }
+
+    @Test
+    void testSessions_KeptApartByDeviceId() {
+        TramOrientationService.Session first = service.getSession("ysg-test-first");
+        TramOrientationService.Session second = service.getSession("ysg-test-second");
+
+        service.setUserLocation(first, 46.77, 23.59, "Piață Unirii");
+
+        assertSame(first, service.getSession("ysg-test-first"));
+        assertEquals("Piață Unirii", first.getUserStopName());
+        assertNull(second.getUserStopName());
+        assertEquals(TramOrientationService.STATUS_NO_TRIP, service.getTramStatus(second).state());
+    }
+
+    @Test
+    void testSessions_WithoutDeviceIdShareTheDefault() {
+        assertEquals(TramOrientationService.DEFAULT_DEVICE, TramOrientationService.deviceKey(null));
+        assertEquals(TramOrientationService.DEFAULT_DEVICE, TramOrientationService.deviceKey(" "));
+        assertSame(service.getSession(null), service.getSession(TramOrientationService.DEFAULT_DEVICE));
+    }
+
+    @Test
+    void testCompactStatus_EncodesFixedLayout() {
+        TramOrientationService.TramStatus status = new TramOrientationService.TramStatus(
+            TramOrientationService.STATUS_APPROACHING,
+            List.of(new TramOrientationService.VehicleApproach(101, 1), new TramOrientationService.VehicleApproach(null, 5)),
+            1700000000L, 42
+        );
+
+        byte[] payload = CompactStatus.encode(status);
+        ByteBuffer buffer = ByteBuffer.wrap(payload).order(ByteOrder.LITTLE_ENDIAN);
+
+        assertEquals(CompactStatus.SIZE, payload.length);
+        assertEquals(CompactStatus.VERSION, buffer.get(0));
+        assertEquals(TramOrientationService.STATUS_APPROACHING, buffer.get(1));
+        assertEquals(2, buffer.get(2));
+        assertEquals(42, buffer.getInt(4));
+        assertEquals(1700000000, buffer.getInt(8));
+        assertEquals(101, buffer.getInt(12));
+        assertEquals(1, buffer.getShort(16));
+        assertEquals(-1, buffer.getInt(20));
+        assertEquals(5, buffer.getShort(24));
+        assertEquals(0, buffer.getInt(28)); // unused slot
+    }
+
+    @Test
+    void testCompactVehicles_EncodesPositionsAndSpeeds() {
+        List<TramOrientationService.Vehicle> vehicles = List.of(
+            new TramOrientationService.Vehicle(101, "T1", 46.770439, 23.591423, "19_1", 20.0),
+            new TramOrientationService.Vehicle(null, "T2", 46.7, -23.5, "19_1", null)
+        );
+
+        byte[] payload = CompactVehicles.encode(List.of(vehicles), 1700000000L);
+        ByteBuffer buffer = ByteBuffer.wrap(payload).order(ByteOrder.LITTLE_ENDIAN);
+
+        assertEquals(CompactVehicles.HEADER_SIZE + 2 * CompactVehicles.RECORD_SIZE, payload.length);
+        assertEquals(CompactVehicles.VERSION, buffer.get(0));
+        assertEquals(2, buffer.get(1));
+        assertEquals(1700000000, buffer.getInt(4));
+        assertEquals(101, buffer.getInt(8));
+        assertEquals(46770439, buffer.getInt(12));
+        assertEquals(23591423, buffer.getInt(16));
+        assertEquals(200, buffer.getShort(20));
+        assertEquals(0, buffer.get(22)); // trip index
+        assertEquals(-1, buffer.getInt(24));
+        assertEquals(-23500000, buffer.getInt(32));
+        assertEquals(0, buffer.getShort(36));
+    }
+
+    @Test
+    void testCompactVehicles_TagsEachVehicleWithItsTrip() {
+        TramOrientationService.Vehicle first = new TramOrientationService.Vehicle(101, "T1", 46.77, 23.59, "19_1", 20.0);
+        TramOrientationService.Vehicle second = new TramOrientationService.Vehicle(202, "T2", 46.78, 23.60, "7_0", 10.0);
+
+        byte[] payload = CompactVehicles.encode(List.of(List.of(first), List.of(), List.of(second)), 1700000000L);
+        ByteBuffer buffer = ByteBuffer.wrap(payload).order(ByteOrder.LITTLE_ENDIAN);
+
+        assertEquals(2, buffer.get(1));
+        assertEquals(0, buffer.get(CompactVehicles.HEADER_SIZE + 14));
+        assertEquals(202, buffer.getInt(CompactVehicles.HEADER_SIZE + CompactVehicles.RECORD_SIZE));
+        assertEquals(2, buffer.get(CompactVehicles.HEADER_SIZE + CompactVehicles.RECORD_SIZE + 14));
+    }
+
+    @Test
+    void testCompactStatus_BatchKeepsRequestOrder() {
+        TramOrientationService.TramStatus passed = new TramOrientationService.TramStatus(
+            TramOrientationService.STATUS_ALL_PASSED, List.of(), 1700000000L, 7);
+        TramOrientationService.TramStatus coming = new TramOrientationService.TramStatus(
+            TramOrientationService.STATUS_APPROACHING, List.of(new TramOrientationService.VehicleApproach(101, 2)), 1700000000L, 8);
+
+        byte[] payload = CompactStatus.encodeBatch(List.of(passed, coming));
+        ByteBuffer buffer = ByteBuffer.wrap(payload).order(ByteOrder.LITTLE_ENDIAN);
+
+        assertEquals(CompactStatus.BATCH_HEADER_SIZE + 2 * CompactStatus.SIZE, payload.length);
+        assertEquals(CompactStatus.BATCH_VERSION, buffer.get(0));
+        assertEquals(2, buffer.get(1));
+        assertEquals(TramOrientationService.STATUS_ALL_PASSED, buffer.get(CompactStatus.BATCH_HEADER_SIZE + 1));
+        assertEquals(TramOrientationService.STATUS_APPROACHING, buffer.get(CompactStatus.BATCH_HEADER_SIZE + CompactStatus.SIZE + 1));
+        assertEquals(8, buffer.getInt(CompactStatus.BATCH_HEADER_SIZE + CompactStatus.SIZE + 4));
+    }
+
+    @Test
+    void testParseWatches_RejectsMalformedAndTooMany() {
+        LinkedMultiValueMap<String, String> params = new LinkedMultiValueMap<>();
+        params.add("watch", "19_1,46.770439,23.591423");
+        params.add("watch", "7_0,46.78,23.6");
+
+        List<TramOrientationService.Watch> watches = TramController.parseWatches(params);
+        assertEquals(2, watches.size());
+        assertEquals("19_1", watches.get(0).tripId());
+        assertEquals(23.6, watches.get(1).lon());
+
+        LinkedMultiValueMap<String, String> odd = new LinkedMultiValueMap<>();
+        odd.add("watch", "19,1#2,46.77,23.59");
+        assertEquals("19,1#2", TramController.parseWatches(odd).get(0).tripId());
+
+        params.add("watch", "7_1,46.78");
+        assertNull(TramController.parseWatches(params));
+
+        LinkedMultiValueMap<String, String> many = new LinkedMultiValueMap<>();
+        for (int i = 0; i <= CompactStatus.MAX_BATCH; i++) {
+            many.add("watch", i + "_0,46.77,23.59");
+        }
+        assertNull(TramController.parseWatches(many));
+    }
+
+    @Test
+    void testCatalogETag_IgnoresLiveVehicleData() {
+        List<TramOrientationService.StationWithVehicle> empty = List.of(
+            new TramOrientationService.StationWithVehicle(1, "Piață Unirii", 46.77, 23.59, List.of(), 0));
+        List<TramOrientationService.StationWithVehicle> busy = List.of(
+            new TramOrientationService.StationWithVehicle(1, "Piață Unirii", 46.77, 23.59,
+                List.of(new TramOrientationService.VehicleInfo(101, "T-101", 30.0)), 1));
+        List<TramOrientationService.StationWithVehicle> moved = List.of(
+            new TramOrientationService.StationWithVehicle(1, "Piață Unirii", 46.78, 23.59, List.of(), 0));
+
+        String etag = TramController.catalogETag(empty, 1, TramController::stationKey);
+        assertEquals(etag, TramController.catalogETag(busy, 1, TramController::stationKey));
+        assertNotEquals(etag, TramController.catalogETag(moved, 1, TramController::stationKey));
+        assertNotEquals(etag, TramController.catalogETag(empty, 2, TramController::stationKey));
+    }
 }
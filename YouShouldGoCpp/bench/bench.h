@@ -0,0 +1,47 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include <chrono>
+// bench.h declares the native benchmark harness and the synthetic catalogs it runs on
+//
+// Build and run with: pio run -e native && .pio/build/native/program
+// Every case prints the time per iteration and per record, so a change to
+// the parse, cache, screen or status code can be compared against the previous run.
+
+#define BENCH_ROUTES 1000
+#define BENCH_TRIPS 4000
+#define BENCH_STATIONS 2000
+#define BENCH_TRIP_STOPS 60
+#define BENCH_MIN_MS 200  // run each case at least this long
+#define BENCH_CACHE_CAPACITY 20480  // bytes, the default NVS partition
+
+// Catalogs shaped like the backend's responses, including the fields the
+// filters drop. The same seed always gives the same catalog.
+std::string syntheticRoutesJson(int count);
+std::string syntheticTripsJson(int count, int routeId);
+std::string syntheticStationsJson(int count);
+
+// Runs fn until BENCH_MIN_MS have passed and prints the average
+template <typename F>
+void bench(const char *name, size_t records, F fn) {
+  using Clock = std::chrono::steady_clock;
+
+  fn();  // warm up caches and the allocator
+  unsigned long iterations = 0;
+  Clock::time_point start = Clock::now();
+  Clock::duration elapsed;
+  do {
+    fn();
+    iterations++;
+    elapsed = Clock::now() - start;
+  } while (elapsed < std::chrono::milliseconds(BENCH_MIN_MS));
+
+  double us = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+  printf("  %-28s %10.1f us/iter %8.3f us/record  (%lu iterations)\n", name, us,
+         records ? us / records : 0.0, iterations);
+}
+
+void benchParse();
+void benchCache();
+void benchScreens();
+void benchStatus();
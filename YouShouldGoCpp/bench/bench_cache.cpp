@@ -0,0 +1,98 @@
+#include "bench.h"
+#include "cache.h"
+#include "catalog.h"
+#include "kvstore.h"
+#include "cacheindex.h"
+#include "MemoryStream.h"
+
+template <typename T>
+static void parseInto(ListPage<T> &page, const std::string &json, void (*makeFilter)(JsonDocument &), std::function<void(ListPage<T> &, JsonObject)> append) {
+  MemoryStream stream(json.data(), json.size());
+  JsonDocument filter;
+  makeFilter(filter);
+  parseJsonArray(stream, filter, [&](JsonObject obj) { append(page, obj); });
+}
+
+// Save and load through the store the way utils.cpp does, without the logging
+template <typename T>
+static void roundTrip(const char *name, const char *key, const std::vector<T> &list,
+                      void (*encode)(const std::vector<T> &, std::vector<uint8_t> &),
+                      void (*decode)(const CacheView &, ListPage<T> &)) {
+  MemoryKvStore store;
+  std::vector<uint8_t> blob;
+  encode(list, blob);
+  printf("  %s: %u records, %u byte blob\n", name, (unsigned)list.size(), (unsigned)blob.size());
+
+  String label = String(name) + " save";
+  bench(label.c_str(), list.size(), [&]() {
+    std::vector<uint8_t> out;
+    encode(list, out);
+    store.setBlob(key, out);
+  });
+
+  label = String(name) + " load";
+  bench(label.c_str(), list.size(), [&]() {
+    std::vector<uint8_t> in;
+    CacheView view;
+    if (!store.getBlob(key, in) || cacheDecode(in, view) != CACHE_OK) {
+      printf("  %s: cache blob rejected\n", name);
+      return;
+    }
+    ListPage<T> page;
+    decode(view, page);
+  });
+}
+
+// Routes opened one after another, every third one a route seen before,
+// against a store a fraction of the catalog's size
+static void benchCacheIndex(const std::vector<uint8_t> &tripsBlob) {
+  MemoryKvStore store(BENCH_CACHE_CAPACITY);
+  CacheIndex index;
+  index.begin(&store);
+
+  int route = 0;
+  bench("lru put/get trips_<route>", 1, [&]() {
+    route++;
+    int key = route % 3 == 0 ? route / 2 : route;
+    String name = "trips_" + String(key);
+    std::vector<uint8_t> in;
+    if (!index.get(name.c_str(), in)) {
+      index.put(name.c_str(), tripsBlob);
+    }
+  });
+
+  const CacheStats &stats = index.stats();
+  printf("  lru: %u entries, %u bytes in a %u byte store, %u hits, %u misses, %u evictions, %u failed writes\n",
+         (unsigned)index.count(), (unsigned)index.bytes(), (unsigned)BENCH_CACHE_CAPACITY, (unsigned)stats.hits,
+         (unsigned)stats.misses, (unsigned)stats.evictions, (unsigned)stats.failedWrites);
+}
+
+void benchCache() {
+  printf("Cache round trips\n");
+
+  ListPage<Route> routes;
+  ListPage<Trip> trips;
+  ListPage<Station> stations;
+  parseInto<Route>(routes, syntheticRoutesJson(BENCH_ROUTES), routeFilter,
+                   [](ListPage<Route> &page, JsonObject obj) { appendRoute(page, obj); });
+  parseInto<Trip>(trips, syntheticTripsJson(BENCH_TRIPS, 42), tripFilter,
+                  [](ListPage<Trip> &page, JsonObject obj) { appendTrip(page, obj, 42); });
+  parseInto<Station>(stations, syntheticStationsJson(BENCH_STATIONS), stationFilter,
+                     [](ListPage<Station> &page, JsonObject obj) { appendStation(page, obj); });
+
+  roundTrip<Route>("routes", "routes", routes.items, encodeRoutes, decodeRoutes);
+  roundTrip<Trip>("trips", "trips_42", trips.items, encodeTrips, decodeTrips);
+  roundTrip<Station>("stations", "stations", stations.items, encodeStations, decodeStations);
+
+  std::vector<uint8_t> blob;
+  encodeStations(stations.items, blob);
+  bench("crc32 of stations blob", 0, [&]() {
+    volatile uint32_t crc = cacheCrc32(blob.data(), blob.size());
+    (void)crc;
+  });
+
+  // A route's worth of trips, the size a trips_<routeId> blob has on the device
+  std::vector<Trip> routeTrips(trips.items.begin(), trips.items.begin() + std::min<size_t>(trips.items.size(), 40));
+  encodeTrips(routeTrips, blob);
+  benchCacheIndex(blob);
+}
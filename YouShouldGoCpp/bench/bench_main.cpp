@@ -0,0 +1,37 @@
+#include "bench.h"
+#include "kvstore.h"
+#include "cacheindex.h"
+
+// Globals main.cpp defines on the device, the screens read them
+ListWindow<Route> routes;
+int currentRouteIndex = 0;
+bool routesLoaded = false;
+
+ListWindow<Trip> trips;
+int currentTripIndex = 0;
+bool tripsLoaded = false;
+
+ListWindow<Station> stations;
+int currentStationIndex = 0;
+bool stationsLoaded = false;
+Screen currentScreen = SCREEN_ROUTES;
+volatile WifiLink wifiLink = WIFI_LINK_UP;
+
+Arduino_GFX *gfx = new Arduino_GFX(320, 170);
+
+// NVS stands in as RAM
+MemoryKvStore memoryStore;
+KvStore *kvStore = &memoryStore;
+CacheIndex catalogCache;
+
+int main() {
+  setenv("TZ", "UTC0", 1);  // status timestamps render the same everywhere
+  tzset();
+
+  printf("Catalog: %d routes, %d trips, %d stations\n", BENCH_ROUTES, BENCH_TRIPS, BENCH_STATIONS);
+  benchParse();
+  benchCache();
+  benchScreens();
+  benchStatus();
+  return 0;
+}
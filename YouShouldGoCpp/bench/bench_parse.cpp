@@ -0,0 +1,43 @@
+#include "bench.h"
+#include "catalog.h"
+#include "MemoryStream.h"
+
+// Streams a whole synthetic response through the filter, like the network
+// task does with a response body
+template <typename T>
+static size_t parseAll(const std::string &json, void (*makeFilter)(JsonDocument &), std::function<void(ListPage<T> &, JsonObject)> append) {
+  MemoryStream stream(json.data(), json.size());
+  JsonDocument filter;
+  makeFilter(filter);
+
+  ListPage<T> page;
+  DeserializationError error = parseJsonArray(stream, filter, [&](JsonObject obj) { append(page, obj); });
+  if (error) {
+    printf("  parse failed: %s\n", error.c_str());
+  }
+  return page.items.size();
+}
+
+void benchParse() {
+  printf("JSON parse\n");
+
+  std::string routesJson = syntheticRoutesJson(BENCH_ROUTES);
+  std::string tripsJson = syntheticTripsJson(BENCH_TRIPS, 42);
+  std::string stationsJson = syntheticStationsJson(BENCH_STATIONS);
+
+  bench("routes", BENCH_ROUTES, [&]() {
+    parseAll<Route>(routesJson, routeFilter, [](ListPage<Route> &page, JsonObject obj) { appendRoute(page, obj); });
+  });
+  bench("trips", BENCH_TRIPS, [&]() {
+    parseAll<Trip>(tripsJson, tripFilter, [](ListPage<Trip> &page, JsonObject obj) { appendTrip(page, obj, 42); });
+  });
+  bench("stations", BENCH_STATIONS, [&]() {
+    parseAll<Station>(stationsJson, stationFilter, [](ListPage<Station> &page, JsonObject obj) { appendStation(page, obj); });
+  });
+
+  // One page is what the device actually receives per request
+  std::string pageJson = syntheticRoutesJson(LIST_PAGE_SIZE);
+  bench("routes, one page", LIST_PAGE_SIZE, [&]() {
+    parseAll<Route>(pageJson, routeFilter, [](ListPage<Route> &page, JsonObject obj) { appendRoute(page, obj); });
+  });
+}
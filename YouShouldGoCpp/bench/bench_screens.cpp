@@ -0,0 +1,104 @@
+#include "bench.h"
+#include "catalog.h"
+#include "utils.h"
+#include "MemoryStream.h"
+
+// Fills a window with its first LIST_WINDOW_PAGES pages, as browsing does.
+// Each page is parsed on its own so its strings live in its own arena.
+template <typename T>
+static void fillWindow(ListWindow<T> &list, const std::string &json, int total, void (*makeFilter)(JsonDocument &),
+                       std::function<void(ListPage<T> &, JsonObject)> append) {
+  JsonDocument filter;
+  makeFilter(filter);
+
+  list.clear();
+  for (int offset = 0; offset < LIST_WINDOW_PAGES * LIST_PAGE_SIZE; offset += LIST_PAGE_SIZE) {
+    MemoryStream stream(json.data(), json.size());
+    ListPage<T> page;
+    int index = 0;
+    parseJsonArray(stream, filter, [&](JsonObject obj) {
+      if (index >= offset && index < offset + LIST_PAGE_SIZE) append(page, obj);
+      index++;
+    });
+    list.merge(offset, total, page, 0);
+  }
+}
+
+static void report(const char *name) {
+  const GfxCounters &c = gfx->counters();
+  printf("  %s: %u fills, %u glyphs, %llu pixels per screen\n", name, (unsigned)c.fills, (unsigned)c.glyphs,
+         (unsigned long long)c.pixels);
+}
+
+// Draws every record in the window once per iteration
+template <typename T>
+static void benchList(const char *name, ListWindow<T> &list, int &index, void (*draw)()) {
+  gfx->resetCounters();
+  index = list.start;
+  draw();
+  report(name);
+
+  int records = list.end() - list.start;
+  bench(name, records, [&]() {
+    for (index = list.start; index < list.end(); index++) {
+      draw();
+    }
+  });
+}
+
+void benchScreens() {
+  printf("Screens\n");
+
+  fillWindow<Route>(routes, syntheticRoutesJson(BENCH_ROUTES), BENCH_ROUTES, routeFilter,
+                    [](ListPage<Route> &page, JsonObject obj) { appendRoute(page, obj); });
+  fillWindow<Trip>(trips, syntheticTripsJson(BENCH_TRIPS, 42), BENCH_TRIPS, tripFilter,
+                   [](ListPage<Trip> &page, JsonObject obj) { appendTrip(page, obj, 42); });
+  fillWindow<Station>(stations, syntheticStationsJson(BENCH_STATIONS), BENCH_STATIONS, stationFilter,
+                      [](ListPage<Station> &page, JsonObject obj) { appendStation(page, obj); });
+  routesLoaded = tripsLoaded = stationsLoaded = true;
+
+  benchList("route screen", routes, currentRouteIndex, displayCurrentRoute);
+  benchList("trip screen", trips, currentTripIndex, displayCurrentTrip);
+  benchList("station screen", stations, currentStationIndex, displayCurrentStation);
+
+  CompactStatus status = {};
+  status.version = COMPACT_STATUS_VERSION;
+  status.state = TRAM_APPROACHING;
+  status.count = COMPACT_STATUS_MAX_VEHICLES;
+  status.seq = 1;
+  status.dataTimestamp = 1760000000;
+  for (int i = 0; i < status.count; i++) {
+    status.vehicles[i].vehicleId = 100 + i;
+    status.vehicles[i].stopsAway = i + 1;
+  }
+
+  gfx->resetCounters();
+  displayStatus(status);
+  report("status screen");
+  bench("status screen", 0, [&]() { displayStatus(status); });
+
+  // A full watchlist, every row with a different stop
+  Watchlist watches;
+  StatusBatch batch = {};
+  for (int i = 0; i < WATCH_MAX; i++) {
+    Watch watch = {};
+    snprintf(watch.tripId, sizeof(watch.tripId), "%d_0", i + 1);
+    snprintf(watch.routeName, sizeof(watch.routeName), "%d", 20 + i);
+    snprintf(watch.stopName, sizeof(watch.stopName), "Observatorului %d", i);
+    watch.lat = 46.77 + i * 0.001;
+    watches.add(watch);
+    batch.status[i] = status;
+    batch.status[i].vehicles[0].stopsAway = i;
+  }
+  batch.count = WATCH_MAX;
+
+  gfx->resetCounters();
+  displayWatchlist(watches, batch, 2);
+  report("watchlist screen");
+  bench("watchlist screen", 0, [&]() { displayWatchlist(watches, batch, 2); });
+
+  bench("wrapped text", 0, [&]() {
+    gfx->fillScreen(BLACK);
+    displayWrappedText("Piata Mihai Viteazu - Cartier Grigorescu - Bulevardul Eroilor - Observatorului - Manastur", 65);
+  });
+}
@@ -0,0 +1,84 @@
+#include "bench.h"
+#include "localstatus.h"
+#include "watchlist.h"
+
+// A long tram line running south-west through Cluj, with a vehicle every
+// few stops in both directions of travel. The feed carries a full watchlist:
+// every watched trip runs on the same line with its own vehicles.
+static void syntheticTrip(TripStops &stops, VehicleFeed &feed) {
+  std::vector<StopPoint> points;
+  for (int i = 0; i < BENCH_TRIP_STOPS; i++) {
+    StopPoint point;
+    point.sequence = i + 1;
+    point.lat = 46.7850f - i * 0.0021f;
+    point.lon = 23.6290f - i * 0.0043f;
+    points.push_back(point);
+  }
+  stops.assign(points);
+
+  feed = {};
+  feed.dataTimestamp = 1760623200;
+  for (int i = 0; i < VEHICLE_FEED_MAX; i++) {
+    const StopPoint &near = stops[(i * 7) % stops.size()];
+    feed.vehicles[i].id = 100 + i;
+    feed.vehicles[i].lat = near.lat + 0.0004f;  // between stops, closer to this one
+    feed.vehicles[i].lon = near.lon - 0.0006f;
+    feed.vehicles[i].speed = (i % 3) * 4.0f;
+    feed.vehicles[i].trip = i % WATCH_MAX;
+  }
+  feed.count = VEHICLE_FEED_MAX;
+}
+
+void benchStatus() {
+  printf("On-device status\n");
+
+  TripStops stops;
+  VehicleFeed feed;
+  syntheticTrip(stops, feed);
+  int userStop = stops.size() / 2;
+
+  VehicleTracker trackers[WATCH_MAX];
+  CompactStatus previous = {};
+  StatusBatch batch = {};
+  batch.count = WATCH_MAX;
+  for (int w = 0; w < WATCH_MAX; w++) {
+    computeStatus(stops, userStop, feed, w, trackers[w], previous, batch.status[w]);
+  }
+  char headline[48];
+  formatStatusHeadline(batch.status[0], headline, sizeof(headline));
+  char hint[32] = "";
+  formatLeaveHint(batch.status[0], hint, sizeof(hint));
+  printf("  %u stops, %u vehicles on %d trips: %s, %s, %u approaching\n", (unsigned)stops.size(),
+         (unsigned)feed.count, WATCH_MAX, headline, hint, (unsigned)batch.status[0].count);
+
+  // Every poll after the first finds each vehicle near its last segment
+  bench("compute watchlist (tracked)", feed.count, [&]() {
+    feed.dataTimestamp += 5;
+    for (int w = 0; w < WATCH_MAX; w++) {
+      computeStatus(stops, userStop, feed, w, trackers[w], previous, batch.status[w]);
+    }
+  });
+
+  bench("compute watchlist (untracked)", feed.count, [&]() {
+    for (int w = 0; w < WATCH_MAX; w++) {
+      trackers[w].clear();
+      computeStatus(stops, userStop, feed, w, trackers[w], previous, batch.status[w]);
+    }
+  });
+
+  uint8_t payload[VEHICLE_FEED_HEADER_SIZE + VEHICLE_FEED_MAX * VEHICLE_FEED_RECORD_SIZE] = {VEHICLE_FEED_VERSION,
+                                                                                           VEHICLE_FEED_MAX};
+  bench("decode vehicle feed", VEHICLE_FEED_MAX, [&]() {
+    decodeVehicleFeed(payload, sizeof(payload), feed);
+  });
+
+  // The backend's answer for the same watchlist
+  uint8_t batchPayload[STATUS_BATCH_HEADER_SIZE + STATUS_BATCH_MAX * sizeof(CompactStatus)] = {STATUS_BATCH_VERSION,
+                                                                                               STATUS_BATCH_MAX};
+  for (int w = 0; w < STATUS_BATCH_MAX; w++) {
+    memcpy(batchPayload + STATUS_BATCH_HEADER_SIZE + w * sizeof(CompactStatus), &batch.status[w], sizeof(CompactStatus));
+  }
+  bench("decode status batch", STATUS_BATCH_MAX, [&]() {
+    decodeStatusBatch(batchPayload, sizeof(batchPayload), batch);
+  });
+}
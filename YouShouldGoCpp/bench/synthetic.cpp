@@ -0,0 +1,79 @@
+#include "bench.h"
+
+// Small LCG so every run sees the same catalog
+static uint32_t seed = 12345;
+
+static uint32_t nextRandom() {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7FFF;
+}
+
+static const char *words[] = {
+  "Piata", "Unirii", "Mihai", "Viteazu", "Gara", "Centrala", "Cartier", "Grigorescu",
+  "Manastur", "Zorilor", "Gheorgheni", "Marasti", "Observatorului", "Bulevardul", "Eroilor", "Sora"
+};
+
+static std::string randomName(int count) {
+  std::string name;
+  for (int i = 0; i < count; i++) {
+    if (i > 0) name += ' ';
+    name += words[nextRandom() % (sizeof(words) / sizeof(words[0]))];
+  }
+  return name;
+}
+
+std::string syntheticRoutesJson(int count) {
+  seed = 1;
+  std::string json = "[";
+  char buf[64];
+  for (int i = 0; i < count; i++) {
+    if (i > 0) json += ",";
+    snprintf(buf, sizeof(buf), "{\"route_id\":%d,\"route_short_name\":\"%d%c\",", 1000 + i, i % 100, 'A' + i % 3);
+    json += buf;
+    json += "\"route_long_name\":\"" + randomName(2) + " - " + randomName(3) + "\",";
+    snprintf(buf, sizeof(buf), "\"route_type\":%d,\"hasVehicle\":%s,", i % 4, nextRandom() % 2 ? "true" : "false");
+    json += buf;
+    json += "\"route_color\":\"FF0000\",\"route_desc\":\"" + randomName(6) + "\"}";
+  }
+  json += "]";
+  return json;
+}
+
+std::string syntheticTripsJson(int count, int routeId) {
+  seed = 2;
+  std::string json = "[";
+  char buf[96];
+  for (int i = 0; i < count; i++) {
+    if (i > 0) json += ",";
+    snprintf(buf, sizeof(buf), "{\"trip_id\":\"%d_%d_%d\",\"route_id\":%d,\"direction_id\":%d,", routeId, i / 2, i % 2,
+             routeId, i % 2);
+    json += buf;
+    // Headsigns repeat a lot in real feeds, which the arena deduplicates
+    json += "\"trip_headsign\":\"" + std::string(words[i % 8]) + " " + words[(i / 8) % 16] + "\",";
+    json += "\"shape_id\":\"shp_" + std::to_string(i % 40) + "\",\"service_id\":\"LV\"}";
+  }
+  json += "]";
+  return json;
+}
+
+std::string syntheticStationsJson(int count) {
+  seed = 3;
+  std::string json = "[";
+  char buf[128];
+  for (int i = 0; i < count; i++) {
+    if (i > 0) json += ",";
+    snprintf(buf, sizeof(buf), "{\"sequence\":%d,\"lat\":%.6f,\"lon\":%.6f,\"hasVehicle\":%s,", i + 1,
+             46.7 + (nextRandom() % 10000) / 1e5, 23.5 + (nextRandom() % 10000) / 1e5, i % 7 == 0 ? "true" : "false");
+    json += buf;
+    json += "\"stationName\":\"" + randomName(1 + i % 3) + "\",\"vehicles\":[";
+    // Vehicle lists are filtered out, but still have to be skipped
+    for (int v = 0; v < (i % 7 == 0 ? 2 : 0); v++) {
+      if (v > 0) json += ",";
+      snprintf(buf, sizeof(buf), "{\"id\":%d,\"label\":\"%d\",\"lat\":46.77,\"lon\":23.59}", v, 100 + v);
+      json += buf;
+    }
+    json += "]}";
+  }
+  json += "]";
+  return json;
+}
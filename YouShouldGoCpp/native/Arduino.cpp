@@ -0,0 +1,240 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <ctype.h>
+
+NativeSerial Serial;
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+
+  char buf[72];
+  char *p = buf + sizeof(buf) - 1;
+  *p = '\0';
+  do {
+    int digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  if (negative) *--p = '-';
+  return std::string(p);
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+  // The core prints negative numbers in other bases as their unsigned form
+  if (value < 0 && base == 10) {
+    return formatInteger(0ULL - (unsigned long long)value, true, base);
+  }
+  return formatInteger((unsigned long long)value, false, base);
+}
+
+String::String(unsigned char value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+  _s = buf;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return _s.size() >= suffix._s.size() && _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = _s.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &s, unsigned int from) const {
+  size_t pos = _s.find(s._s, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t pos = _s.rfind(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c, unsigned int from) const {
+  if (from >= _s.size()) return lastIndexOf(c);
+  size_t pos = _s.rfind(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+  return from < _s.size() ? String(_s.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int t = from;
+    from = to;
+    to = t;
+  }
+  if (from >= _s.size()) return String();
+  return String(_s.substr(from, to - from));
+}
+
+void String::replace(const String &find, const String &replacement) {
+  if (find._s.empty()) return;
+
+  size_t pos = 0;
+  while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+    _s.replace(pos, find._s.size(), replacement._s);
+    pos += replacement._s.size();
+  }
+}
+
+void String::trim() {
+  size_t begin = 0;
+  while (begin < _s.size() && isspace((unsigned char)_s[begin])) begin++;
+  size_t end = _s.size();
+  while (end > begin && isspace((unsigned char)_s[end - 1])) end--;
+  _s = _s.substr(begin, end - begin);
+}
+
+StringSumHelper operator+(const String &a, const String &b) {
+  StringSumHelper sum(a);
+  sum.concat(b);
+  return sum;
+}
+
+StringSumHelper operator+(const String &a, const char *b) {
+  StringSumHelper sum(a);
+  sum.concat(b);
+  return sum;
+}
+
+StringSumHelper operator+(const char *a, const String &b) {
+  StringSumHelper sum(a);
+  sum.concat(b);
+  return sum;
+}
+
+StringSumHelper operator+(const String &a, char c) {
+  StringSumHelper sum(a);
+  sum.concat(c);
+  return sum;
+}
+
+#if !(defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38)))
+size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size > 0) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+
+  if (len < 0) return 0;
+  return write((const uint8_t *)buf, (size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = read();
+    if (c < 0) break;
+    buffer[n++] = (char)c;
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String s;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) {
+    s += (char)c;
+  }
+  return s;
+}
+
+bool Stream::findUntil(const char *target, const char *terminator) {
+  size_t targetLen = strlen(target);
+  size_t termLen = terminator ? strlen(terminator) : 0;
+  size_t targetMatched = 0;
+  size_t termMatched = 0;
+
+  if (targetLen == 0) return true;
+
+  int c;
+  while ((c = read()) >= 0) {
+    // Targets here are short, restarting at the current byte is enough
+    targetMatched = (c == target[targetMatched]) ? targetMatched + 1 : (c == target[0] ? 1 : 0);
+    if (targetMatched == targetLen) return true;
+
+    if (termLen > 0) {
+      termMatched = (c == terminator[termMatched]) ? termMatched + 1 : (c == terminator[0] ? 1 : 0);
+      if (termMatched == termLen) return false;
+    }
+  }
+  return false;
+}
+
+static unsigned long long fakeMicros = 0;
+
+unsigned long millis() {
+  return fakeMicros / 1000;
+}
+
+unsigned long micros() {
+  return fakeMicros;
+}
+
+void delay(unsigned long ms) {
+  fakeClockAdvance(ms);
+}
+
+void fakeClockAdvance(unsigned long ms) {
+  fakeMicros += (unsigned long long)ms * 1000;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+  if (caps & MALLOC_CAP_SPIRAM) return nullptr;
+  return malloc(size);
+}
+
+void heap_caps_free(void *p) {
+  free(p);
+}
+
+// The host heap is not the device heap, diagnostics just read zero
+size_t heap_caps_get_free_size(uint32_t) {
+  return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t) {
+  return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t) {
+  return 0;
+}
+
+size_t heap_caps_get_total_size(uint32_t) {
+  return 0;
+}
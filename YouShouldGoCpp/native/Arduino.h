@@ -0,0 +1,170 @@
+#pragma once
+//pragma to only include once
+// native/Arduino.h is the slice of the Arduino-ESP32 core the portable sources use
+//
+// Only built for env:native. String, Print and Stream behave like the core's
+// for what the firmware calls; the clock is a fake that only moves when told
+// to, the heap has no PSRAM and FreeRTOS calls are single-task no-ops.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+class String {
+public:
+  String() {}
+  String(const char *s) : _s(s ? s : "") {}
+  String(const std::string &s) : _s(s) {}
+  explicit String(char c) : _s(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimals = 2);
+  explicit String(double value, unsigned int decimals = 2);
+
+  const char *c_str() const { return _s.c_str(); }
+  unsigned int length() const { return _s.length(); }
+  bool isEmpty() const { return _s.empty(); }
+  bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+  bool concat(const String &s) { _s += s._s; return true; }
+  bool concat(const char *s) { if (s) _s += s; return s != nullptr; }
+  bool concat(const char *s, unsigned int len) { _s.append(s, len); return true; }
+  bool concat(char c) { _s += c; return true; }
+  String &operator+=(const String &s) { concat(s); return *this; }
+  String &operator+=(const char *s) { concat(s); return *this; }
+  String &operator+=(char c) { concat(c); return *this; }
+
+  char operator[](unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+
+  bool equals(const String &s) const { return _s == s._s; }
+  bool operator==(const String &s) const { return _s == s._s; }
+  bool operator==(const char *s) const { return _s == (s ? s : ""); }
+  bool operator!=(const String &s) const { return _s != s._s; }
+  bool operator!=(const char *s) const { return !(*this == s); }
+  bool operator<(const String &s) const { return _s < s._s; }
+  bool startsWith(const String &prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+  bool endsWith(const String &suffix) const;
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &s, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  int lastIndexOf(char c, unsigned int from) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+
+  void replace(const String &find, const String &replacement);
+  void trim();
+  long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+  double toDouble() const { return strtod(_s.c_str(), nullptr); }
+  float toFloat() const { return (float)toDouble(); }
+
+private:
+  std::string _s;
+};
+
+// The core builds concatenations in a StringSumHelper, ArduinoJson names it
+class StringSumHelper : public String {
+public:
+  StringSumHelper(const String &s) : String(s) {}
+};
+
+StringSumHelper operator+(const String &a, const String &b);
+StringSumHelper operator+(const String &a, const char *b);
+StringSumHelper operator+(const char *a, const String &b);
+StringSumHelper operator+(const String &a, char c);
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value) { return print(String(value)); }
+  size_t print(unsigned int value) { return print(String(value)); }
+  size_t print(long value) { return print(String(value)); }
+  size_t print(unsigned long value) { return print(String(value)); }
+  size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+
+  size_t println() { return write((const uint8_t *)"\r\n", 2); }
+  template <typename T>
+  size_t println(const T &value) { size_t n = print(value); return n + println(); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long) {}
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+  String readStringUntil(char terminator);
+
+  // Read up to and including target, false if the stream ends first
+  bool find(const char *target) { return findUntil(target, nullptr); }
+  // As find(), but also stops (returning false) after terminator
+  bool findUntil(const char *target, const char *terminator);
+};
+
+// Newer glibc has it, the ESP32 newlib always does
+#if !(defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38)))
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+// Serial prints to stdout
+class NativeSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() override { fflush(stdout); }
+};
+
+extern NativeSerial Serial;
+
+// Fake clock, starts at 0 and only moves through delay() and fakeClockAdvance()
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void fakeClockAdvance(unsigned long ms);
+
+// Heap capabilities, a host build has no PSRAM
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void heap_caps_free(void *p);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_total_size(uint32_t caps);
+
+// FreeRTOS, everything runs on the one host thread
+typedef void *TaskHandle_t;
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline unsigned int uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
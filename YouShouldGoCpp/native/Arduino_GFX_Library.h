@@ -0,0 +1,83 @@
+#pragma once
+//pragma to only include once
+#include "Arduino.h"
+// native/Arduino_GFX_Library.h is a fake display with the Arduino_GFX calls the screens use
+//
+// Nothing is rasterised. Drawing calls are counted, with the pixels the
+// real library would have touched (6x8 glyphs scaled by the text size), so
+// screen code can be timed and compared without a panel.
+
+#define BLACK 0x0000
+#define WHITE 0xFFFF
+#define RED 0xF800
+#define GREEN 0x07E0
+#define BLUE 0x001F
+#define CYAN 0x07FF
+#define MAGENTA 0xF81F
+#define YELLOW 0xFFE0
+#define ORANGE 0xFD20
+#define DARKGREY 0x7BEF
+
+#define GFX_NOT_DEFINED -1
+
+class Arduino_DataBus {};
+
+struct GfxCounters {
+  uint32_t fills;
+  uint32_t glyphs;
+  uint32_t flushes;
+  uint64_t pixels;
+};
+
+class Arduino_GFX : public Print {
+public:
+  Arduino_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+  virtual bool begin(int32_t speed = GFX_NOT_DEFINED) { (void)speed; return true; }
+  void flush() override { _counters.flushes++; }
+
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+  void setRotation(uint8_t) {}
+  void displayOff() {}
+
+  void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+  void fillRect(int16_t, int16_t, int16_t w, int16_t h, uint16_t) {
+    _counters.fills++;
+    _counters.pixels += (uint64_t)w * h;
+  }
+  void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t, uint16_t color) { fillRect(x, y, w, h, color); }
+  void fillCircle(int16_t x, int16_t y, int16_t r, uint16_t color) { fillRect(x - r, y - r, 2 * r + 1, 2 * r + 1, color); }
+  void drawRoundRect(int16_t, int16_t, int16_t w, int16_t h, int16_t, uint16_t) { _counters.pixels += 2 * (w + h); }
+
+  void setTextSize(uint8_t size) { _textSize = size ? size : 1; }
+  void setTextColor(uint16_t color) { _textColor = color; }
+  void setCursor(int16_t x, int16_t y) {
+    _cursorX = x;
+    _cursorY = y;
+  }
+
+  size_t write(uint8_t c) override {
+    if (c == '\n') {
+      _cursorX = 0;
+      _cursorY += 8 * _textSize;
+    } else if (c != '\r') {
+      _counters.glyphs++;
+      _counters.pixels += 6 * 8 * _textSize * _textSize;
+      _cursorX += 6 * _textSize;
+    }
+    return 1;
+  }
+
+  const GfxCounters &counters() const { return _counters; }
+  void resetCounters() { _counters = GfxCounters(); }
+
+private:
+  int16_t _width;
+  int16_t _height;
+  int16_t _cursorX = 0;
+  int16_t _cursorY = 0;
+  uint8_t _textSize = 1;
+  uint16_t _textColor = WHITE;
+  GfxCounters _counters = {};
+};
@@ -0,0 +1,21 @@
+#pragma once
+//pragma to only include once
+#include "Arduino.h"
+// native/MemoryStream.h stands in for an HTTP response body held in memory
+
+class MemoryStream : public Stream {
+public:
+  MemoryStream(const char *data, size_t length) : _data(data), _length(length) {}
+
+  int available() override { return _length - _pos; }
+  int read() override { return _pos < _length ? (uint8_t)_data[_pos++] : -1; }
+  int peek() override { return _pos < _length ? (uint8_t)_data[_pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+  void rewind() { _pos = 0; }
+
+private:
+  const char *_data;
+  size_t _length;
+  size_t _pos = 0;
+};
@@ -1,15 +1,19 @@
 #pragma once
 //pragma to only include once
 // app.h includes libraries and shared data types, globals
+#ifdef ARDUINO
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
+#include <Preferences.h>
+#else
+#include <Arduino.h>  // native build, see native/
+#endif
 #include <ArduinoJson.h>
 #include <Arduino_GFX_Library.h>
-#include <Preferences.h>
-#include <nvs.h>
-#include <nvs_flash.h>
 #include <vector>
+#include <functional>
+#include "window.h"
 
 #ifndef WIFI_SSID
 #define WIFI_SSID "MyNetwork"
@@ -17,35 +21,54 @@
 #ifndef WIFI_PASS
 #define WIFI_PASS "1976@bond"
 #endif
+// http:// is allowed too, for the local replay backend
+#ifndef SERVER_URL
+#define SERVER_URL "https://youshouldgo.onrender.com"
+#endif
+// A fixed address skips DHCP at boot (fastwifi.h), all four are needed
+// #define STATIC_IP "192.168.1.60"
+// #define STATIC_GATEWAY "192.168.1.1"
+// #define STATIC_SUBNET "255.255.255.0"
+// #define STATIC_DNS "192.168.1.1"
 
+// Record strings point into the StringArena of the list page holding the
+// record and are only valid while that page is in its window
 struct Route {
   int route_id;
-  String route_short_name;
-  String route_long_name;
-  int route_type;
-  int hasVehicle;
+  const char *route_short_name;
+  const char *route_long_name;
+  int16_t route_type;
+  uint8_t hasVehicle;
 };
 
 struct Trip {
-  String trip_id;
-  int route_id;
-  int direction_id;
-  String trip_headsign;
+  const char *trip_id;
+  int32_t route_id;
+  const char *trip_headsign;
+  int8_t direction_id;
 };
 
 struct Station {
-  int sequence;
-  String name;
+  int32_t sequence;
+  const char *name;
   double lat;
   double lon;
-  int hasVehicle;
+  uint8_t hasVehicle;
 };
 
 enum Screen {
   SCREEN_ROUTES,
   SCREEN_TRIPS,
   SCREEN_STATIONS,
-  SCREEN_STATUS
+  SCREEN_STATUS,
+  SCREEN_DIAG
+};
+
+// Set by the WiFi supervisor (fastwifi.h), shown in the screens' corner
+enum WifiLink : uint8_t {
+  WIFI_LINK_CONNECTING,
+  WIFI_LINK_UP,
+  WIFI_LINK_DOWN   // waiting to retry
 };
 
 //use extern to declare the variables once, and define them in main.cpp
@@ -53,25 +76,29 @@ extern const char* ssid;
 extern const char* password;
 extern const char* serverUrl;
 
-extern std::vector<Route> routes;
+extern ListWindow<Route> routes;
 extern int currentRouteIndex;
 extern bool routesLoaded;
 
-extern std::vector<Trip> trips;
+extern ListWindow<Trip> trips;
 extern int currentTripIndex;
 extern bool tripsLoaded;
 
-extern std::vector<Station> stations;
+extern ListWindow<Station> stations;
 extern int currentStationIndex;
 extern bool stationsLoaded;
-extern unsigned long lastButtonPress;
 extern Screen currentScreen;
+extern volatile WifiLink wifiLink;  // the network tasks read it too
 
 extern Arduino_DataBus *bus;
-extern Arduino_GFX *gfx;
+extern Arduino_GFX *panel;  // the ST7789 itself
+extern Arduino_GFX *gfx;    // off-screen canvas in front of it, draw here and flush()
+
+// seq of the network request the UI is currently waiting on (0 = none)
+extern uint32_t uiAwaitingSeq;
 
-// NVS handle and error code for direct NVS operations
-extern nvs_handle_t nvsHandle;
-extern esp_err_t nvsErr;
 extern void getStatus();
-void selectStation();
\ No newline at end of file
+void selectStation();
+void onSelectClick();
+void deferUi(unsigned long delayMs, std::function<void()> action);
+void cancelDeferredUi();
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "arena.h"
+
+static void *arenaAlloc(size_t bytes) {
+  void *p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  return p ? p : heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+}
+
+// FNV-1a
+static uint32_t hashString(const char *s) {
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h = (h ^ (uint8_t)*s++) * 16777619u;
+  }
+  return h;
+}
+
+StringArena::~StringArena() {
+  reset();
+}
+
+void StringArena::reset() {
+  while (_blocks) {
+    Block *next = _blocks->next;
+    heap_caps_free(_blocks);
+    _blocks = next;
+  }
+  if (_table) {
+    heap_caps_free(_table);
+    _table = nullptr;
+  }
+  _tableSize = 0;
+  _count = 0;
+  _used = 0;
+  _reserved = 0;
+}
+
+char *StringArena::allocate(size_t len) {
+  if (!_blocks || _blocks->size - _blocks->used < len) {
+    // Oversized strings get a block of their own
+    size_t size = len > ARENA_BLOCK_SIZE ? len : ARENA_BLOCK_SIZE;
+    Block *block = (Block *)arenaAlloc(sizeof(Block) + size);
+    if (!block) return nullptr;
+
+    block->size = size;
+    block->used = 0;
+    block->next = _blocks;
+    _blocks = block;
+    _reserved += sizeof(Block) + size;
+  }
+
+  char *p = _blocks->data() + _blocks->used;
+  _blocks->used += len;
+  _used += len;
+  return p;
+}
+
+bool StringArena::growTable() {
+  size_t newSize = _tableSize ? _tableSize * 2 : ARENA_TABLE_INITIAL;
+  const char **table = (const char **)arenaAlloc(newSize * sizeof(const char *));
+  if (!table) return false;
+  memset(table, 0, newSize * sizeof(const char *));
+
+  for (size_t i = 0; i < _tableSize; i++) {
+    if (!_table[i]) continue;
+    size_t slot = hashString(_table[i]) & (newSize - 1);
+    while (table[slot]) slot = (slot + 1) & (newSize - 1);
+    table[slot] = _table[i];
+  }
+
+  if (_table) heap_caps_free(_table);
+  _table = table;
+  _tableSize = newSize;
+  return true;
+}
+
+const char *StringArena::intern(const char *s) {
+  if (!s || !*s) return "";
+
+  // Keep the dedup table at most 3/4 full
+  if ((_count + 1) * 4 > _tableSize * 3 && !growTable()) {
+    return "";
+  }
+
+  size_t slot = hashString(s) & (_tableSize - 1);
+  while (_table[slot]) {
+    if (strcmp(_table[slot], s) == 0) return _table[slot];
+    slot = (slot + 1) & (_tableSize - 1);
+  }
+
+  size_t len = strlen(s) + 1;
+  char *copy = allocate(len);
+  if (!copy) {
+    Serial.println("[ARENA] ERROR: out of memory");
+    return "";
+  }
+  memcpy(copy, s, len);
+
+  _table[slot] = copy;
+  _count++;
+  return copy;
+}
@@ -0,0 +1,47 @@
+#pragma once
+//pragma to only include once
+#include <Arduino.h>
+// arena.h declares StringArena, bump-allocated and deduplicated storage for record strings
+//
+// Strings are copied into fixed blocks (PSRAM when the board has it) that
+// never move, so records keep plain const char * into them instead of one
+// heap String each. Nothing is freed string by string: the whole arena goes
+// at once with the list page that owns it.
+
+#define ARENA_BLOCK_SIZE 1024
+#define ARENA_TABLE_INITIAL 32  // dedup slots, power of two
+
+class StringArena {
+public:
+  StringArena() {}
+  ~StringArena();
+  StringArena(const StringArena &) = delete;
+  StringArena &operator=(const StringArena &) = delete;
+
+  // Returns the arena copy of s, the same pointer for equal strings
+  const char *intern(const char *s);
+  const char *intern(const String &s) { return intern(s.c_str()); }
+  void reset();
+
+  size_t count() const { return _count; }        // distinct strings
+  size_t bytesUsed() const { return _used; }     // string bytes incl. NULs
+  size_t bytesReserved() const { return _reserved; }
+
+private:
+  struct Block {
+    Block *next;
+    size_t size;
+    size_t used;
+    char *data() { return (char *)(this + 1); }
+  };
+
+  char *allocate(size_t len);
+  bool growTable();
+
+  Block *_blocks = nullptr;
+  const char **_table = nullptr;
+  size_t _tableSize = 0;
+  size_t _count = 0;
+  size_t _used = 0;
+  size_t _reserved = 0;
+};
@@ -0,0 +1,106 @@
+#include "buttons.h"
+#include "tasks.h"
+
+#define BUTTON_QUEUE_LENGTH 16
+
+struct ButtonState {
+  uint8_t pin;
+  ButtonId id;
+  bool repeats;        // NEXT auto-repeats instead of long/clear gestures
+  bool pressed;        // debounced level
+  uint32_t pressStart;
+  uint32_t lastTick;
+  bool longFired;
+  bool clearFired;
+  TimerHandle_t debounceTimer;
+  TimerHandle_t holdTimer;
+};
+
+static ButtonState buttonStates[] = {
+  {BTN_NEXT, BUTTON_NEXT, true},
+  {BTN_SELECT, BUTTON_SELECT, false},
+};
+
+static QueueHandle_t buttonQueue = NULL;
+
+static void postButtonEvent(ButtonState *b, ButtonGesture gesture, uint32_t heldMs) {
+  ButtonEvent event = {b->id, gesture, heldMs};
+  if (xQueueSend(buttonQueue, &event, 0) == pdTRUE) {
+    wakeUi();
+  }
+}
+
+// Hold timer: runs every HOLD_TICK_MS while a button is down
+static void onHoldTick(TimerHandle_t timer) {
+  ButtonState *b = (ButtonState *)pvTimerGetTimerID(timer);
+  uint32_t now = millis();
+  uint32_t held = now - b->pressStart;
+
+  if (b->repeats) {
+    if (held >= REPEAT_DELAY_MS && now - b->lastTick >= REPEAT_INTERVAL_MS) {
+      b->lastTick = now;
+      postButtonEvent(b, GESTURE_REPEAT, held);
+    }
+    return;
+  }
+
+  if (!b->longFired && held >= LONG_PRESS_MS) {
+    b->longFired = true;
+    postButtonEvent(b, GESTURE_LONG_PRESS, held);
+  }
+
+  if (!b->clearFired && held >= CLEAR_NVS_PRESS_MS) {
+    b->clearFired = true;
+    postButtonEvent(b, GESTURE_CLEAR_HOLD, held);
+  } else if (!b->clearFired && held >= POPUP_START_DELAY && now - b->lastTick >= POPUP_UPDATE_INTERVAL) {
+    b->lastTick = now;
+    postButtonEvent(b, GESTURE_HOLD_TICK, held);
+  }
+}
+
+// Debounce timer: the line has been quiet for DEBOUNCE_MS, take its level
+static void onDebounced(TimerHandle_t timer) {
+  ButtonState *b = (ButtonState *)pvTimerGetTimerID(timer);
+  bool down = (digitalRead(b->pin) == LOW);
+  if (down == b->pressed) return;
+
+  b->pressed = down;
+  uint32_t now = millis();
+
+  if (down) {
+    b->pressStart = now;
+    b->lastTick = now;
+    b->longFired = false;
+    b->clearFired = false;
+    postButtonEvent(b, GESTURE_PRESS, 0);
+    xTimerStart(b->holdTimer, 0);
+  } else {
+    xTimerStop(b->holdTimer, 0);
+    postButtonEvent(b, b->longFired ? GESTURE_RELEASE : GESTURE_CLICK, now - b->pressStart);
+  }
+}
+
+static void IRAM_ATTR onButtonEdge(void *arg) {
+  ButtonState *b = (ButtonState *)arg;
+  BaseType_t woken = pdFALSE;
+  xTimerResetFromISR(b->debounceTimer, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+void initButtons() {
+  buttonQueue = xQueueCreate(BUTTON_QUEUE_LENGTH, sizeof(ButtonEvent));
+
+  for (ButtonState &b : buttonStates) {
+    pinMode(b.pin, INPUT_PULLUP);
+    b.pressed = false;
+    b.debounceTimer = xTimerCreate("btn_db", pdMS_TO_TICKS(DEBOUNCE_MS), pdFALSE, &b, onDebounced);
+    b.holdTimer = xTimerCreate("btn_hold", pdMS_TO_TICKS(HOLD_TICK_MS), pdTRUE, &b, onHoldTick);
+    attachInterruptArg(digitalPinToInterrupt(b.pin), onButtonEdge, &b, CHANGE);
+  }
+}
+
+bool receiveButtonEvent(ButtonEvent &event) {
+  return xQueueReceive(buttonQueue, &event, 0) == pdTRUE;
+}
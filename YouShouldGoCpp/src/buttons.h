@@ -0,0 +1,44 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+// buttons.h declares the interrupt-driven button engine and the gesture events it produces
+//
+// GPIO edges only restart a debounce timer from the ISR. The timer callback
+// samples the settled level and a per-button hold timer turns presses into
+// gestures, which are queued for the UI loop.
+
+#define BTN_NEXT 14
+#define BTN_SELECT 0
+
+#define DEBOUNCE_MS 30
+#define HOLD_TICK_MS 50
+#define LONG_PRESS_MS 800
+#define CLEAR_NVS_PRESS_MS 10000
+#define POPUP_START_DELAY 1000
+#define POPUP_UPDATE_INTERVAL 200
+#define REPEAT_DELAY_MS 500
+#define REPEAT_INTERVAL_MS 200
+
+enum ButtonId {
+  BUTTON_NEXT,
+  BUTTON_SELECT
+};
+
+enum ButtonGesture {
+  GESTURE_PRESS,       // button went down
+  GESTURE_CLICK,       // released before LONG_PRESS_MS
+  GESTURE_LONG_PRESS,  // held for LONG_PRESS_MS (once per press)
+  GESTURE_HOLD_TICK,   // still held after POPUP_START_DELAY, every POPUP_UPDATE_INTERVAL
+  GESTURE_CLEAR_HOLD,  // held for CLEAR_NVS_PRESS_MS (once per press)
+  GESTURE_REPEAT,      // auto-repeat while held, repeating buttons only
+  GESTURE_RELEASE      // released after a long press
+};
+
+struct ButtonEvent {
+  ButtonId button;
+  ButtonGesture gesture;
+  uint32_t heldMs;
+};
+
+void initButtons();
+bool receiveButtonEvent(ButtonEvent &event);
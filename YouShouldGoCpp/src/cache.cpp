@@ -0,0 +1,207 @@
+#include "cache.h"
+
+uint32_t StringTable::add(const String &s) {
+  auto it = _offsets.find(s);
+  if (it != _offsets.end()) {
+    return it->second;
+  }
+
+  uint32_t offset = _data.size();
+  _data.insert(_data.end(), s.c_str(), s.c_str() + s.length());
+  _data.push_back('\0');
+  _offsets[s] = offset;
+  return offset;
+}
+
+// Bitwise CRC32 (IEEE), blobs are a few KB so a table is not worth the flash
+uint32_t cacheCrc32(const uint8_t *data, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+void cacheEncode(std::vector<uint8_t> &out, uint16_t recordSize, uint32_t recordCount, const void *records, const StringTable &strings) {
+  const std::vector<char> &table = strings.data();
+  size_t recordsSize = (size_t)recordSize * recordCount;
+
+  out.resize(sizeof(CacheHeader) + recordsSize + table.size());
+  uint8_t *body = out.data() + sizeof(CacheHeader);
+
+  if (recordsSize > 0) {
+    memcpy(body, records, recordsSize);
+  }
+  if (!table.empty()) {
+    memcpy(body + recordsSize, table.data(), table.size());
+  }
+
+  CacheHeader header;
+  header.magic = CACHE_MAGIC;
+  header.version = CACHE_VERSION;
+  header.recordSize = recordSize;
+  header.recordCount = recordCount;
+  header.stringsSize = table.size();
+  header.crc = cacheCrc32(body, recordsSize + table.size());
+  memcpy(out.data(), &header, sizeof(header));
+}
+
+CacheStatus cacheDecode(const std::vector<uint8_t> &blob, CacheView &view) {
+  if (blob.size() < sizeof(CacheHeader)) {
+    return (!blob.empty() && blob[0] == '[') ? CACHE_LEGACY_JSON : CACHE_BAD_HEADER;
+  }
+
+  CacheHeader header;
+  memcpy(&header, blob.data(), sizeof(header));
+
+  if (header.magic != CACHE_MAGIC) {
+    return blob[0] == '[' ? CACHE_LEGACY_JSON : CACHE_BAD_HEADER;
+  }
+
+  if (header.version != CACHE_VERSION || header.recordSize == 0) {
+    return CACHE_BAD_VERSION;
+  }
+
+  size_t bodySize = (size_t)header.recordSize * header.recordCount + header.stringsSize;
+  if (blob.size() != sizeof(CacheHeader) + bodySize) {
+    return CACHE_BAD_HEADER;
+  }
+
+  const uint8_t *body = blob.data() + sizeof(CacheHeader);
+  if (cacheCrc32(body, bodySize) != header.crc) {
+    return CACHE_BAD_CRC;
+  }
+
+  view.recordSize = header.recordSize;
+  view.recordCount = header.recordCount;
+  view.records = body;
+  view.strings = (const char *)(body + (size_t)header.recordSize * header.recordCount);
+  view.stringsSize = header.stringsSize;
+  return CACHE_OK;
+}
+
+const char *cacheStatusString(CacheStatus status) {
+  switch (status) {
+    case CACHE_OK:
+      return "OK";
+    case CACHE_LEGACY_JSON:
+      return "LEGACY_JSON";
+    case CACHE_BAD_HEADER:
+      return "BAD_HEADER";
+    case CACHE_BAD_VERSION:
+      return "BAD_VERSION";
+    case CACHE_BAD_CRC:
+      return "BAD_CRC";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+void encodeRoutes(const std::vector<Route> &list, std::vector<uint8_t> &blob) {
+  StringTable strings;
+  std::vector<PackedRoute> packed(list.size());
+
+  for (size_t i = 0; i < list.size(); i++) {
+    const Route &r = list[i];
+    PackedRoute &p = packed[i];
+    memset(&p, 0, sizeof(p));
+    p.route_id = r.route_id;
+    p.route_short_name = strings.add(r.route_short_name);
+    p.route_long_name = strings.add(r.route_long_name);
+    p.route_type = r.route_type;
+    p.hasVehicle = r.hasVehicle;
+  }
+
+  cacheEncode(blob, sizeof(PackedRoute), packed.size(), packed.data(), strings);
+}
+
+void decodeRoutes(const CacheView &view, ListPage<Route> &page) {
+  std::vector<Route> &list = page.items;
+  list.clear();
+  list.reserve(view.recordCount);
+
+  for (uint32_t i = 0; i < view.recordCount; i++) {
+    PackedRoute p;
+    cacheRecordAt(view, i, p);
+    Route r;
+    r.route_id = p.route_id;
+    r.route_short_name = page.strings->intern(cacheString(view, p.route_short_name));
+    r.route_long_name = page.strings->intern(cacheString(view, p.route_long_name));
+    r.route_type = p.route_type;
+    r.hasVehicle = p.hasVehicle;
+    list.push_back(r);
+  }
+}
+
+void encodeTrips(const std::vector<Trip> &list, std::vector<uint8_t> &blob) {
+  StringTable strings;
+  std::vector<PackedTrip> packed(list.size());
+
+  for (size_t i = 0; i < list.size(); i++) {
+    const Trip &t = list[i];
+    PackedTrip &p = packed[i];
+    memset(&p, 0, sizeof(p));
+    p.trip_id = strings.add(t.trip_id);
+    p.route_id = t.route_id;
+    p.trip_headsign = strings.add(t.trip_headsign);
+    p.direction_id = t.direction_id;
+  }
+
+  cacheEncode(blob, sizeof(PackedTrip), packed.size(), packed.data(), strings);
+}
+
+void decodeTrips(const CacheView &view, ListPage<Trip> &page) {
+  std::vector<Trip> &list = page.items;
+  list.clear();
+  list.reserve(view.recordCount);
+
+  for (uint32_t i = 0; i < view.recordCount; i++) {
+    PackedTrip p;
+    cacheRecordAt(view, i, p);
+    Trip t;
+    t.trip_id = page.strings->intern(cacheString(view, p.trip_id));
+    t.route_id = p.route_id;
+    t.direction_id = p.direction_id;
+    t.trip_headsign = page.strings->intern(cacheString(view, p.trip_headsign));
+    list.push_back(t);
+  }
+}
+
+void encodeStations(const std::vector<Station> &list, std::vector<uint8_t> &blob) {
+  StringTable strings;
+  std::vector<PackedStation> packed(list.size());
+
+  for (size_t i = 0; i < list.size(); i++) {
+    const Station &s = list[i];
+    PackedStation &p = packed[i];
+    memset(&p, 0, sizeof(p));
+    p.sequence = s.sequence;
+    p.name = strings.add(s.name);
+    p.lat_e6 = lround(s.lat * 1e6);
+    p.lon_e6 = lround(s.lon * 1e6);
+    p.hasVehicle = s.hasVehicle;
+  }
+
+  cacheEncode(blob, sizeof(PackedStation), packed.size(), packed.data(), strings);
+}
+
+void decodeStations(const CacheView &view, ListPage<Station> &page) {
+  std::vector<Station> &list = page.items;
+  list.clear();
+  list.reserve(view.recordCount);
+
+  for (uint32_t i = 0; i < view.recordCount; i++) {
+    PackedStation p;
+    cacheRecordAt(view, i, p);
+    Station s;
+    s.sequence = p.sequence;
+    s.name = page.strings->intern(cacheString(view, p.name));
+    s.lat = p.lat_e6 / 1e6;
+    s.lon = p.lon_e6 / 1e6;
+    s.hasVehicle = p.hasVehicle;
+    list.push_back(s);
+  }
+}
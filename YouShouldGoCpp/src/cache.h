@@ -0,0 +1,100 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include <map>
+// cache.h declares the packed binary record format used for the NVS catalog caches
+//
+// Blob layout: CacheHeader | recordCount fixed-size records | string table
+// Strings are stored once in the table (NUL terminated) and records refer to
+// them by byte offset. recordSize is stored so a newer firmware can read
+// records written with fewer fields (missing trailing fields read as zero).
+
+#define CACHE_MAGIC 0x43475359  // "YSGC"
+#define CACHE_VERSION 2         // version 1 stored the lists as JSON text
+
+struct __attribute__((packed)) CacheHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t recordCount;
+  uint32_t stringsSize;
+  uint32_t crc;  // CRC32 of records + string table
+};
+
+struct __attribute__((packed)) PackedRoute {
+  int32_t route_id;
+  uint32_t route_short_name;
+  uint32_t route_long_name;
+  int16_t route_type;
+  uint8_t hasVehicle;
+  uint8_t reserved;
+};
+
+struct __attribute__((packed)) PackedTrip {
+  uint32_t trip_id;
+  int32_t route_id;
+  uint32_t trip_headsign;
+  int8_t direction_id;
+  uint8_t reserved[3];
+};
+
+struct __attribute__((packed)) PackedStation {
+  int32_t sequence;
+  uint32_t name;
+  int32_t lat_e6;  // degrees * 1e6, same precision the firmware sends back
+  int32_t lon_e6;
+  uint8_t hasVehicle;
+  uint8_t reserved[3];
+};
+
+enum CacheStatus {
+  CACHE_OK,
+  CACHE_LEGACY_JSON,
+  CACHE_BAD_HEADER,
+  CACHE_BAD_VERSION,
+  CACHE_BAD_CRC
+};
+
+// Deduplicating string table builder
+class StringTable {
+public:
+  uint32_t add(const String &s);
+  const std::vector<char> &data() const { return _data; }
+
+private:
+  std::vector<char> _data;
+  std::map<String, uint32_t> _offsets;
+};
+
+// Read-only view into a decoded blob, valid while the blob is alive
+struct CacheView {
+  uint16_t recordSize;
+  uint32_t recordCount;
+  const uint8_t *records;
+  const char *strings;
+  uint32_t stringsSize;
+};
+
+uint32_t cacheCrc32(const uint8_t *data, size_t len);
+void cacheEncode(std::vector<uint8_t> &out, uint16_t recordSize, uint32_t recordCount, const void *records, const StringTable &strings);
+CacheStatus cacheDecode(const std::vector<uint8_t> &blob, CacheView &view);
+const char *cacheStatusString(CacheStatus status);
+
+// Record lists to and from blobs, decoded strings are interned into the page
+void encodeRoutes(const std::vector<Route> &list, std::vector<uint8_t> &blob);
+void decodeRoutes(const CacheView &view, ListPage<Route> &page);
+void encodeTrips(const std::vector<Trip> &list, std::vector<uint8_t> &blob);
+void decodeTrips(const CacheView &view, ListPage<Trip> &page);
+void encodeStations(const std::vector<Station> &list, std::vector<uint8_t> &blob);
+void decodeStations(const CacheView &view, ListPage<Station> &page);
+
+inline const char *cacheString(const CacheView &view, uint32_t offset) {
+  return offset < view.stringsSize ? view.strings + offset : "";
+}
+
+template <typename T>
+void cacheRecordAt(const CacheView &view, uint32_t index, T &out) {
+  memset(&out, 0, sizeof(T));
+  size_t n = view.recordSize < sizeof(T) ? view.recordSize : sizeof(T);
+  memcpy(&out, view.records + (size_t)index * view.recordSize, n);
+}
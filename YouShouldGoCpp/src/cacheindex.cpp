@@ -0,0 +1,180 @@
+#include "cacheindex.h"
+#include "cache.h"
+
+struct __attribute__((packed)) PackedCacheEntry {
+  uint32_t key;
+  uint32_t size;
+  uint32_t lastUsed;
+};
+
+void CacheIndex::begin(KvStore *store) {
+  _store = store;
+  _entries.clear();
+  _clock = 0;
+
+  std::vector<uint8_t> blob;
+  if (!_store->getBlob(CACHE_INDEX_KEY, blob)) {
+    return;
+  }
+
+  CacheView view;
+  if (cacheDecode(blob, view) != CACHE_OK || view.recordSize != sizeof(PackedCacheEntry)) {
+    Serial.println("[NVS] ERROR: cache index rejected, starting a new one");
+    return;
+  }
+
+  for (uint32_t i = 0; i < view.recordCount && _entries.size() < CACHE_INDEX_MAX; i++) {
+    PackedCacheEntry p;
+    cacheRecordAt(view, i, p);
+    CacheEntry entry = {};
+    strlcpy(entry.key, cacheString(view, p.key), sizeof(entry.key));
+    entry.size = p.size;
+    entry.lastUsed = p.lastUsed;
+    _entries.push_back(entry);
+    _clock = std::max(_clock, entry.lastUsed);
+  }
+  Serial.println("[NVS] Cache index: " + String(_entries.size()) + " entries, " + String(bytes()) + " bytes");
+}
+
+bool CacheIndex::get(const char *key, std::vector<uint8_t> &out) {
+  int index = find(key);
+  if (!_store->getBlob(key, out)) {
+    _stats.misses++;
+    if (index >= 0) {
+      // Gone from the store behind the index's back
+      _entries.erase(_entries.begin() + index);
+      save();
+    }
+    return false;
+  }
+  _stats.hits++;
+
+  if (index < 0) {
+    // Cached before there was an index, tracked from now on
+    if (_entries.size() >= CACHE_INDEX_MAX) {
+      evictOldest(key);
+    }
+    CacheEntry entry = {};
+    strlcpy(entry.key, key, sizeof(entry.key));
+    entry.size = out.size();
+    entry.lastUsed = ++_clock;
+    _entries.push_back(entry);
+    save();
+    return true;
+  }
+  _entries[index].size = out.size();
+  touch(index);
+  return true;
+}
+
+bool CacheIndex::put(const char *key, const std::vector<uint8_t> &data) {
+  if (find(key) < 0 && _entries.size() >= CACHE_INDEX_MAX) {
+    evictOldest(key);
+  }
+
+  // A replaced blob is counted too, NVS writes the new one before it
+  // erases the old one
+  size_t free;
+  if (_store->freeBytes(free)) {
+    size_t needed = data.size() + CACHE_ENTRY_OVERHEAD + CACHE_FREE_RESERVE;
+    while (free < needed && evictOldest(key)) {
+      if (!_store->freeBytes(free)) break;
+    }
+  }
+
+  while (!_store->setBlob(key, data)) {
+    if (!evictOldest(key)) {
+      _stats.failedWrites++;
+      Serial.println("[NVS] WARNING: " + String(key) + " not cached, nothing left to evict");
+      save();
+      return false;
+    }
+  }
+
+  int index = find(key);
+  if (index < 0) {
+    CacheEntry entry = {};
+    strlcpy(entry.key, key, sizeof(entry.key));
+    _entries.push_back(entry);
+    index = _entries.size() - 1;
+  }
+  _entries[index].size = data.size();
+  _entries[index].lastUsed = ++_clock;
+  save();
+  return true;
+}
+
+void CacheIndex::remove(const char *key) {
+  int index = find(key);
+  if (index >= 0) {
+    erase(index);
+    save();
+  }
+}
+
+void CacheIndex::clear() {
+  _entries.clear();
+  _clock = 0;
+}
+
+uint32_t CacheIndex::bytes() const {
+  uint32_t total = 0;
+  for (const CacheEntry &entry : _entries) {
+    total += entry.size;
+  }
+  return total;
+}
+
+int CacheIndex::find(const char *key) const {
+  for (size_t i = 0; i < _entries.size(); i++) {
+    if (strncmp(_entries[i].key, key, CACHE_KEY_LEN) == 0) return i;
+  }
+  return -1;
+}
+
+// Reads only move the entry in RAM, the order reaches flash with the next
+// write (put, eviction or removal), so a list load costs no flash write
+void CacheIndex::touch(int index) {
+  if (_entries[index].lastUsed == _clock && _clock != 0) return;
+  _entries[index].lastUsed = ++_clock;
+}
+
+bool CacheIndex::evictOldest(const char *keep) {
+  int oldest = -1;
+  for (size_t i = 0; i < _entries.size(); i++) {
+    if (strncmp(_entries[i].key, keep, CACHE_KEY_LEN) == 0) continue;
+    if (oldest < 0 || _entries[i].lastUsed < _entries[oldest].lastUsed) {
+      oldest = i;
+    }
+  }
+  if (oldest < 0) return false;
+
+  Serial.println("[NVS] Evicting " + String(_entries[oldest].key) + " (" + String(_entries[oldest].size) + " bytes)");
+  erase(oldest);
+  _stats.evictions++;
+  return true;
+}
+
+void CacheIndex::erase(int index) {
+  String key = _entries[index].key;
+  _store->erase(key.c_str());
+  _store->erase(("e_" + key).c_str());
+  _store->erase(("n_" + key).c_str());
+  _entries.erase(_entries.begin() + index);
+}
+
+void CacheIndex::save() {
+  StringTable strings;
+  std::vector<PackedCacheEntry> packed(_entries.size());
+  for (size_t i = 0; i < _entries.size(); i++) {
+    packed[i].key = strings.add(_entries[i].key);
+    packed[i].size = _entries[i].size;
+    packed[i].lastUsed = _entries[i].lastUsed;
+  }
+
+  std::vector<uint8_t> blob;
+  cacheEncode(blob, sizeof(PackedCacheEntry), packed.size(), packed.data(), strings);
+  if (!_store->setBlob(CACHE_INDEX_KEY, blob)) {
+    Serial.println("[NVS] WARNING: cache index was not saved");
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+//pragma to only include once
+#include <Arduino.h>
+#include <vector>
+#include "kvstore.h"
+// cacheindex.h declares the size-budgeted LRU index over the catalog caches
+//
+// Every route opened adds a trips_<routeId> blob and every trip a stations
+// blob, so left alone the namespace fills up until writes fail. The index
+// remembers each cached blob's size and when it was last used, and before a
+// write evicts the least recently used ones until the write leaves
+// CACHE_FREE_RESERVE bytes free in the store (the partition's free entries on
+// the device, whatever namespace holds the rest). The index itself
+// is a packed cache blob (cache.h) under CACHE_INDEX_KEY, saved when entries
+// are added or removed. The order reads give is kept in RAM until then.
+//
+// An entry's validator (e_<key>) and total (n_<key>) go with it when it is
+// evicted. Keys outside the index, like the watchlist, are never touched.
+
+#define CACHE_INDEX_KEY "cidx"
+#define CACHE_INDEX_MAX 48         // blobs tracked, the oldest is dropped to track another
+#define CACHE_KEY_LEN 16           // NVS keys are at most 15 characters
+#define CACHE_FREE_RESERVE 8192    // for settings, the watchlist, other namespaces and NVS's spare page
+#define CACHE_ENTRY_OVERHEAD 96    // store bytes a blob takes beyond its data (entry headers, index)
+
+struct CacheEntry {
+  char key[CACHE_KEY_LEN];
+  uint32_t size;      // bytes of data
+  uint32_t lastUsed;  // CacheIndex clock when it was last read or written
+};
+
+struct CacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t failedWrites;  // nothing left to evict and the store still refused
+};
+
+// Used from the network task only (setup() aside)
+class CacheIndex {
+public:
+  // Reads the index back from store, an unreadable one starts empty
+  void begin(KvStore *store);
+
+  bool get(const char *key, std::vector<uint8_t> &out);
+  // Evicts until data fits the budget, then writes it. A store that still
+  // reports no space has entries evicted until the write goes through.
+  bool put(const char *key, const std::vector<uint8_t> &data);
+  void remove(const char *key);
+  // Forgets every entry, for after the store was erased
+  void clear();
+
+  bool contains(const char *key) const { return find(key) >= 0; }
+  size_t count() const { return _entries.size(); }
+  uint32_t bytes() const;
+  const CacheStats &stats() const { return _stats; }
+
+private:
+  int find(const char *key) const;
+  void touch(int index);
+  bool evictOldest(const char *keep);
+  void erase(int index);
+  void save();
+
+  KvStore *_store = nullptr;
+  std::vector<CacheEntry> _entries;
+  uint32_t _clock = 0;
+  CacheStats _stats = {};
+};
+
+// The catalog caches' index, defined in main.cpp
+extern CacheIndex catalogCache;
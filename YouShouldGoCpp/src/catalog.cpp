@@ -0,0 +1,88 @@
+#include "catalog.h"
+
+void routeFilter(JsonDocument &filter) {
+  filter["route_id"] = true;
+  filter["route_short_name"] = true;
+  filter["route_long_name"] = true;
+  filter["route_type"] = true;
+  filter["hasVehicle"] = true;
+}
+
+void tripFilter(JsonDocument &filter) {
+  filter["trip_id"] = true;
+  filter["route_id"] = true;
+  filter["direction_id"] = true;
+  filter["trip_headsign"] = true;
+}
+
+// The per-station vehicle lists are never used on the device
+void stationFilter(JsonDocument &filter) {
+  filter["sequence"] = true;
+  filter["stationName"] = true;
+  filter["lat"] = true;
+  filter["lon"] = true;
+  filter["hasVehicle"] = true;
+}
+
+void appendRoute(ListPage<Route> &page, JsonObject obj) {
+  Route r;
+  r.route_id = obj["route_id"];
+  r.route_short_name = page.strings->intern(obj["route_short_name"].as<const char*>());
+  r.route_long_name = page.strings->intern(obj["route_long_name"].as<const char*>());
+  r.route_type = obj["route_type"] | 0;
+  r.hasVehicle = obj["hasVehicle"] | 0;
+  page.items.push_back(r);
+}
+
+void appendTrip(ListPage<Trip> &page, JsonObject obj, int routeId) {
+  Trip t;
+  t.trip_id = page.strings->intern(obj["trip_id"].as<const char*>());
+  t.route_id = obj["route_id"] | routeId;
+  t.direction_id = obj["direction_id"] | 0;
+  t.trip_headsign = page.strings->intern(obj["trip_headsign"].as<const char*>());
+  page.items.push_back(t);
+}
+
+// Version 1 caches stored the name as "name", the API sends "stationName"
+void appendStation(ListPage<Station> &page, JsonObject obj, const char *nameKey) {
+  Station s;
+  s.sequence = obj["sequence"];
+  s.name = page.strings->intern(obj[nameKey].as<const char*>());
+  s.lat = obj["lat"];
+  s.lon = obj["lon"];
+  s.hasVehicle = obj["hasVehicle"];
+  page.items.push_back(s);
+}
+
+// Walks a top-level JSON array and hands each element to onElement, so only
+// one filtered element is held in memory at a time regardless of array size.
+DeserializationError parseJsonArray(Stream &stream, JsonDocument &filter, std::function<void(JsonObject)> onElement) {
+  if (!stream.find("[")) {
+    return DeserializationError::InvalidInput;
+  }
+
+  JsonDocument doc;
+  while (true) {
+    int c = stream.peek();
+    while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+      stream.read();
+      c = stream.peek();
+    }
+    if (c == ']') {
+      stream.read();
+      break;
+    }
+
+    DeserializationError error = deserializeJson(doc, stream, DeserializationOption::Filter(filter));
+    if (error) {
+      return error;
+    }
+    onElement(doc.as<JsonObject>());
+
+    if (!stream.findUntil(",", "]")) {
+      break;
+    }
+  }
+
+  return DeserializationError::Ok;
+}
@@ -0,0 +1,19 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+// catalog.h declares how the catalog JSON of the backend becomes records
+//
+// Used for streamed API responses and for migrating version 1 JSON caches.
+// Nothing here touches the network or NVS, so it also runs in the native build.
+
+// Filters keep only the fields the device uses
+void routeFilter(JsonDocument &filter);
+void tripFilter(JsonDocument &filter);
+void stationFilter(JsonDocument &filter);
+
+// Append one element to the page, interning its strings into the page arena
+void appendRoute(ListPage<Route> &page, JsonObject obj);
+void appendTrip(ListPage<Trip> &page, JsonObject obj, int routeId);
+void appendStation(ListPage<Station> &page, JsonObject obj, const char *nameKey = "stationName");
+
+DeserializationError parseJsonArray(Stream &stream, JsonDocument &filter, std::function<void(JsonObject)> onElement);
@@ -0,0 +1,149 @@
+#include "compactstatus.h"
+
+bool decodeCompactStatus(const uint8_t *data, size_t len, CompactStatus &out) {
+  if (len < sizeof(CompactStatus) || data[0] != COMPACT_STATUS_VERSION) {
+    return false;
+  }
+
+  memcpy(&out, data, sizeof(CompactStatus));
+  if (out.count > COMPACT_STATUS_MAX_VEHICLES || out.state > TRAM_ALL_PASSED) {
+    memset(&out, 0, sizeof(out));
+    return false;
+  }
+  return true;
+}
+
+bool decodeStatusBatch(const uint8_t *data, size_t len, StatusBatch &out) {
+  out.count = 0;
+  if (len < STATUS_BATCH_HEADER_SIZE || data[0] != STATUS_BATCH_VERSION) {
+    return false;
+  }
+
+  size_t count = data[1];
+  if (count > STATUS_BATCH_MAX || len < STATUS_BATCH_HEADER_SIZE + count * sizeof(CompactStatus)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (!decodeCompactStatus(data + STATUS_BATCH_HEADER_SIZE + i * sizeof(CompactStatus), sizeof(CompactStatus), out.status[i])) {
+      return false;
+    }
+  }
+  out.count = count;
+  return true;
+}
+
+// Lower is more urgent: an approaching vehicle, then a stop that has seen
+// them all pass, then stops that could not be resolved at all
+static int urgencyRank(const CompactStatus &status) {
+  switch (status.state) {
+    case TRAM_APPROACHING: return status.count > 0 ? 0 : 1;
+    case TRAM_ALL_PASSED: return 2;
+    default: return 3;
+  }
+}
+
+// The status that should drive polling and standby: the nearest approaching
+// vehicle of any stop, "all passed" ahead of any stop in error
+const CompactStatus &mostUrgentStatus(const StatusBatch &batch) {
+  static const CompactStatus none = {};
+  const CompactStatus *best = nullptr;
+
+  for (uint8_t i = 0; i < batch.count; i++) {
+    const CompactStatus &status = batch.status[i];
+    int rank = urgencyRank(status);
+    if (!best || rank < urgencyRank(*best) ||
+        (rank == 0 && urgencyRank(*best) == 0 && status.vehicles[0].stopsAway < best->vehicles[0].stopsAway)) {
+      best = &status;
+    }
+  }
+  return best ? *best : none;
+}
+
+static int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Same payload as hex text, the way the SSE stream carries it
+bool decodeCompactStatusHex(const char *hex, CompactStatus &out) {
+  uint8_t data[sizeof(CompactStatus)];
+
+  for (size_t i = 0; i < sizeof(data); i++) {
+    int hi = hexNibble(hex[2 * i]);
+    int lo = hi < 0 ? -1 : hexNibble(hex[2 * i + 1]);
+    if (lo < 0) return false;
+    data[i] = (hi << 4) | lo;
+  }
+
+  return decodeCompactStatus(data, sizeof(data), out);
+}
+
+// Same wording the text /api/status uses
+void formatStatusHeadline(const CompactStatus &status, char *out, size_t len) {
+  switch (status.state) {
+    case TRAM_NO_TRIP:
+      strlcpy(out, "Please select a trip first", len);
+      break;
+    case TRAM_NO_STATION:
+      strlcpy(out, "Please select your station first", len);
+      break;
+    case TRAM_MAP_ERROR:
+      strlcpy(out, "Map Error, hashmap not built", len);
+      break;
+    case TRAM_ALL_PASSED:
+      strlcpy(out, "all vehicles passed your stop", len);
+      break;
+    default: {
+      int stops = status.count > 0 ? status.vehicles[0].stopsAway : -1;
+      if (stops == 1) {
+        strlcpy(out, "Next Stop", len);
+      } else if (stops == 0) {
+        strlcpy(out, "In Station", len);
+      } else {
+        snprintf(out, len, "%d stops away", stops);
+      }
+      break;
+    }
+  }
+}
+
+// "Leave in 3 min" for the first vehicle the user can still walk to, false
+// without arrival estimates
+bool formatLeaveHint(const CompactStatus &status, char *out, size_t len) {
+  if (!(status.flags & COMPACT_STATUS_HAS_ETA) || status.state != TRAM_APPROACHING || status.count == 0) {
+    return false;
+  }
+
+  // If every one is too close the last is the best bet
+  int i = 0;
+  while (i < status.count - 1 && status.vehicles[i].etaS < WALK_TO_STOP_S) i++;
+
+  int etaMin = (status.vehicles[i].etaS + 30) / 60;
+  int leaveMin = ((int)status.vehicles[i].etaS - WALK_TO_STOP_S) / 60;
+  if (leaveMin <= 0) {
+    snprintf(out, len, "Leave now! (tram %d)", etaMin);
+  } else {
+    snprintf(out, len, "Leave in %d min (tram %d)", leaveMin, etaMin);
+  }
+  return true;
+}
+
+// A few characters for one row of the watchlist screen
+void formatStatusShort(const CompactStatus &status, char *out, size_t len) {
+  if (status.version == 0) {
+    strlcpy(out, "...", len);
+  } else if (status.state == TRAM_ALL_PASSED) {
+    strlcpy(out, "passed", len);
+  } else if (status.state != TRAM_APPROACHING || status.count == 0) {
+    strlcpy(out, "no data", len);
+  } else {
+    int stops = status.vehicles[0].stopsAway;
+    int written = stops == 0 ? snprintf(out, len, "here") : snprintf(out, len, "%d st", stops);
+    if ((status.flags & COMPACT_STATUS_HAS_ETA) && written > 0 && (size_t)written < len) {
+      snprintf(out + written, len - written, " ~%dm", (status.vehicles[0].etaS + 30) / 60);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+// compactstatus.h declares the fixed-layout status payload of /api/status/compact
+//
+// Mirrors CompactStatus.java: 44 bytes, little endian like the ESP32 itself,
+// so a payload is validated and copied straight into the struct. The status
+// changed exactly when seq did. Arrival estimates are only filled in by the
+// on-device computation (localstatus.h), the backend leaves them 0.
+//
+// /api/status/batch answers a whole watchlist at once: a 4 byte header
+// (u8 version | u8 count | u16 reserved) and then count statuses in the order
+// the stops were asked for.
+
+#define COMPACT_STATUS_VERSION 1
+#define COMPACT_STATUS_MAX_VEHICLES 4
+#define COMPACT_STATUS_HAS_ETA 0x01  // flags: vehicles[].etaS are set
+#define STATUS_BATCH_VERSION 1
+#define STATUS_BATCH_HEADER_SIZE 4
+#define STATUS_BATCH_MAX 8
+
+#ifndef WALK_TO_STOP_S
+#define WALK_TO_STOP_S 180  // time to walk to the stop, "Leave in" allows for it
+#endif
+
+enum TramState : uint8_t {
+  TRAM_NO_TRIP,
+  TRAM_NO_STATION,
+  TRAM_MAP_ERROR,
+  TRAM_APPROACHING,  // vehicles[0] is the nearest
+  TRAM_ALL_PASSED
+};
+
+struct __attribute__((packed)) CompactVehicle {
+  int32_t vehicleId;
+  int16_t stopsAway;
+  uint16_t etaS;     // seconds until it reaches the user's stop
+};
+
+// All zero (version 0) means "no status yet"
+struct __attribute__((packed)) CompactStatus {
+  uint8_t version;
+  uint8_t state;
+  uint8_t count;
+  uint8_t flags;
+  uint32_t seq;
+  uint32_t dataTimestamp;  // unix seconds when the backend read the vehicle positions
+  CompactVehicle vehicles[COMPACT_STATUS_MAX_VEHICLES];
+};
+
+static_assert(sizeof(CompactStatus) == 44, "CompactStatus must match the backend layout");
+
+// One status per watched stop, same order as the watchlist
+struct StatusBatch {
+  uint8_t count;
+  CompactStatus status[STATUS_BATCH_MAX];
+};
+
+bool decodeCompactStatus(const uint8_t *data, size_t len, CompactStatus &out);
+bool decodeCompactStatusHex(const char *hex, CompactStatus &out);
+bool decodeStatusBatch(const uint8_t *data, size_t len, StatusBatch &out);
+const CompactStatus &mostUrgentStatus(const StatusBatch &batch);
+void formatStatusHeadline(const CompactStatus &status, char *out, size_t len);
+bool formatLeaveHint(const CompactStatus &status, char *out, size_t len);
+void formatStatusShort(const CompactStatus &status, char *out, size_t len);
@@ -0,0 +1,172 @@
+#include "diag.h"
+#include "cacheindex.h"
+
+struct DiagOpStats {
+  uint32_t count;
+  uint32_t beginFree;      // free heap at the last DIAG_BEGIN
+  int32_t worstDelta;      // most heap an operation ended up holding
+  uint32_t lowestFree;     // lowest free heap seen at either end
+};
+
+struct DiagTask {
+  TaskHandle_t handle;
+  const char *name;
+};
+
+static const char *opNames[DIAG_OP_COUNT] = {
+  "routes", "trips", "stations", "save routes", "save trips", "save stations",
+  "status", "select", "periodic", "warm"
+};
+
+// Samples come from the UI loop and the network task
+static portMUX_TYPE diagMux = portMUX_INITIALIZER_UNLOCKED;
+static DiagSample ring[DIAG_RING_SIZE];
+static size_t ringNext = 0;
+static size_t ringCount = 0;
+static DiagOpStats opStats[DIAG_OP_COUNT];
+static DiagTask tasks[DIAG_MAX_TASKS];
+static size_t taskCount = 0;
+static unsigned long nextSummary = DIAG_SUMMARY_MS;
+
+static const char *bootNames[DIAG_BOOT_EVENT_COUNT] = {"first frame", "wifi", "first status"};
+static uint32_t bootMs[DIAG_BOOT_EVENT_COUNT];  // 0 until reached
+
+void diagRegisterTask(TaskHandle_t task, const char *name) {
+  portENTER_CRITICAL(&diagMux);
+  if (taskCount < DIAG_MAX_TASKS) {
+    tasks[taskCount].handle = task;
+    tasks[taskCount].name = name;
+    taskCount++;
+  }
+  portEXIT_CRITICAL(&diagMux);
+}
+
+const char *diagOpName(DiagOp op) {
+  return op < DIAG_OP_COUNT ? opNames[op] : "?";
+}
+
+void diagSample(DiagOp op, DiagPhase phase) {
+  if (op >= DIAG_OP_COUNT) return;
+
+  // Read outside the lock, the heap calls take their own
+  DiagSample sample;
+  sample.ms = millis();
+  sample.op = op;
+  sample.phase = phase;
+  sample.stackFree = uxTaskGetStackHighWaterMark(NULL);
+  sample.freeHeap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  sample.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  sample.freePsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+  portENTER_CRITICAL(&diagMux);
+  ring[ringNext] = sample;
+  ringNext = (ringNext + 1) % DIAG_RING_SIZE;
+  if (ringCount < DIAG_RING_SIZE) ringCount++;
+
+  DiagOpStats &stats = opStats[op];
+  if (stats.lowestFree == 0 || sample.freeHeap < stats.lowestFree) {
+    stats.lowestFree = sample.freeHeap;
+  }
+  if (phase == DIAG_BEGIN) {
+    stats.beginFree = sample.freeHeap;
+  } else {
+    stats.count++;
+    if (stats.beginFree > 0) {
+      int32_t delta = (int32_t)stats.beginFree - (int32_t)sample.freeHeap;
+      if (delta > stats.worstDelta) stats.worstDelta = delta;
+      stats.beginFree = 0;
+    }
+  }
+  portEXIT_CRITICAL(&diagMux);
+}
+
+// Copies up to max samples, newest first
+size_t diagRecent(DiagSample *out, size_t max) {
+  portENTER_CRITICAL(&diagMux);
+  size_t n = ringCount < max ? ringCount : max;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = ring[(ringNext + DIAG_RING_SIZE - 1 - i) % DIAG_RING_SIZE];
+  }
+  portEXIT_CRITICAL(&diagMux);
+  return n;
+}
+
+size_t diagTaskStacks(DiagTaskStack *out, size_t max) {
+  portENTER_CRITICAL(&diagMux);
+  size_t n = taskCount < max ? taskCount : max;
+  DiagTask copy[DIAG_MAX_TASKS];
+  memcpy(copy, tasks, sizeof(DiagTask) * n);
+  portEXIT_CRITICAL(&diagMux);
+
+  for (size_t i = 0; i < n; i++) {
+    out[i].name = copy[i].name;
+    out[i].stackFree = uxTaskGetStackHighWaterMark(copy[i].handle);
+  }
+  return n;
+}
+
+// millis() counts from reset, so it is the time since boot
+void diagBootMark(DiagBootEvent event) {
+  if (bootMs[event] != 0) return;
+  bootMs[event] = std::max(millis(), 1UL);
+  Serial.println("[BOOT] " + String(bootNames[event]) + " at " + String(bootMs[event]) + " ms");
+}
+
+void diagPrintSummary() {
+  uint32_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  uint32_t minFree = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  uint32_t psramTotal = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+  // Share of free memory that is not in the largest block
+  int frag = freeHeap > 0 ? 100 - (int)((uint64_t)largest * 100 / freeHeap) : 0;
+
+  Serial.println("[DIAG] Uptime " + String(millis() / 1000) + " s, heap free " + String(freeHeap) +
+                 ", min " + String(minFree) + ", largest " + String(largest) + ", frag " + String(frag) + "%");
+  if (psramTotal > 0) {
+    Serial.println("[DIAG] PSRAM free " + String(heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) + " of " + String(psramTotal));
+  }
+
+  DiagTaskStack stacks[DIAG_MAX_TASKS];
+  size_t n = diagTaskStacks(stacks, DIAG_MAX_TASKS);
+  String line = "[DIAG] Stack free:";
+  for (size_t i = 0; i < n; i++) {
+    line += " " + String(stacks[i].name) + " " + String(stacks[i].stackFree);
+  }
+  Serial.println(line);
+
+  String boot = "[DIAG] Boot:";
+  for (int event = 0; event < DIAG_BOOT_EVENT_COUNT; event++) {
+    boot += " " + String(bootNames[event]) + " " + (bootMs[event] ? String(bootMs[event]) + " ms" : String("-"));
+  }
+  Serial.println(boot);
+
+  const CacheStats &cache = catalogCache.stats();
+  Serial.println("[DIAG] Cache " + String(catalogCache.count()) + " entries, " + String(catalogCache.bytes()) +
+                 " bytes, hits " + String(cache.hits) + ", misses " + String(cache.misses) + ", evictions " +
+                 String(cache.evictions) + ", failed writes " + String(cache.failedWrites));
+
+  DiagOpStats stats[DIAG_OP_COUNT];
+  portENTER_CRITICAL(&diagMux);
+  memcpy(stats, opStats, sizeof(stats));
+  portEXIT_CRITICAL(&diagMux);
+
+  for (int op = 0; op < DIAG_OP_COUNT; op++) {
+    if (stats[op].count == 0) continue;
+    Serial.println("[DIAG]   " + String(opNames[op]) + ": " + String(stats[op].count) + "x, lowest heap " +
+                   String(stats[op].lowestFree) + ", worst held " + String(stats[op].worstDelta));
+  }
+}
+
+// Called from the UI loop, takes a periodic sample and prints the summary
+void diagTick(unsigned long now) {
+  if ((long)(now - nextSummary) < 0) return;
+  nextSummary = now + DIAG_SUMMARY_MS;
+
+  diagSample(DIAG_PERIODIC, DIAG_END);
+  diagPrintSummary();
+}
+
+unsigned long diagMsUntilSummary(unsigned long now) {
+  long due = (long)(nextSummary - now);
+  return due > 0 ? due : 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+// diag.h declares the heap, PSRAM and stack instrumentation
+//
+// Major operations take a sample when they start and when they end. Samples
+// go into a small ring buffer, a summary is printed on Serial every
+// DIAG_SUMMARY_MS and the diagnostics screen (hold BTN2, press BTN1) shows
+// the latest ones.
+
+#define DIAG_RING_SIZE 32
+#define DIAG_MAX_TASKS 4
+#define DIAG_SUMMARY_MS 60000
+
+enum DiagOp : uint8_t {
+  DIAG_FETCH_ROUTES,
+  DIAG_FETCH_TRIPS,
+  DIAG_FETCH_STATIONS,
+  DIAG_SAVE_ROUTES,
+  DIAG_SAVE_TRIPS,
+  DIAG_SAVE_STATIONS,
+  DIAG_STATUS_POLL,
+  DIAG_SELECT_STATION,
+  DIAG_PERIODIC,
+  DIAG_WARM,
+  DIAG_OP_COUNT
+};
+
+enum DiagPhase : uint8_t {
+  DIAG_BEGIN,
+  DIAG_END
+};
+
+// Boot milestones, each recorded once
+enum DiagBootEvent : uint8_t {
+  DIAG_BOOT_FIRST_FRAME,   // a list or status drawn, from the cache or not
+  DIAG_BOOT_WIFI,
+  DIAG_BOOT_FIRST_STATUS,  // a status from the backend (or the vehicle feed)
+  DIAG_BOOT_EVENT_COUNT
+};
+
+struct DiagSample {
+  uint32_t ms;             // millis() when taken
+  DiagOp op;
+  DiagPhase phase;
+  uint16_t stackFree;      // high-water mark of the sampling task, bytes
+  uint32_t freeHeap;       // internal RAM
+  uint32_t largestBlock;   // largest internal block that can be allocated
+  uint32_t freePsram;      // 0 on boards without PSRAM
+};
+
+struct DiagTaskStack {
+  const char *name;
+  uint32_t stackFree;      // lowest free stack seen so far, bytes
+};
+
+void diagRegisterTask(TaskHandle_t task, const char *name);
+void diagSample(DiagOp op, DiagPhase phase);
+size_t diagRecent(DiagSample *out, size_t max);
+size_t diagTaskStacks(DiagTaskStack *out, size_t max);
+const char *diagOpName(DiagOp op);
+void diagBootMark(DiagBootEvent event);  // UI loop
+void diagPrintSummary();
+void diagTick(unsigned long now);
+unsigned long diagMsUntilSummary(unsigned long now);
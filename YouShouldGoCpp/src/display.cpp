@@ -0,0 +1,78 @@
+#include "display.h"
+
+DiffCanvas::DiffCanvas(int16_t w, int16_t h, Arduino_G *output)
+  : Arduino_Canvas(w, h, output) {
+}
+
+bool DiffCanvas::begin(int32_t speed) {
+  if (!Arduino_Canvas::begin(speed)) {
+    return false;
+  }
+
+  size_t frameBytes = (size_t)_width * _height * sizeof(uint16_t);
+  _front = (uint16_t *)heap_caps_malloc(frameBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  _scratch = (uint16_t *)heap_caps_malloc((size_t)_width * BAND_ROWS * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+  if (!_front || !_scratch) {
+    // Without the shadow copy every flush pushes the whole frame
+    Serial.println("[DISPLAY] No memory for shadow framebuffer, using full flushes");
+    heap_caps_free(_front);
+    heap_caps_free(_scratch);
+    _front = nullptr;
+    _scratch = nullptr;
+    return true;
+  }
+
+  // Panel is cleared to black in initDisplay(), so start from a black shadow
+  memset(_front, 0, frameBytes);
+  return true;
+}
+
+void DiffCanvas::pushRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+  for (int16_t row = 0; row < h; row++) {
+    uint16_t *src = _framebuffer + (size_t)(y + row) * _width + x;
+    memcpy(_scratch + (size_t)row * w, src, w * sizeof(uint16_t));
+    memcpy(_front + (size_t)(y + row) * _width + x, src, w * sizeof(uint16_t));
+  }
+  _output->draw16bitRGBBitmap(_output_x + x, _output_y + y, _scratch, w, h);
+  _lastFlushPixels += (uint32_t)w * h;
+}
+
+void DiffCanvas::flush() {
+  if (!_front) {
+    Arduino_Canvas::flush();
+    _lastFlushPixels = (uint32_t)_width * _height;
+    return;
+  }
+
+  _lastFlushPixels = 0;
+
+  for (int16_t bandY = 0; bandY < _height; bandY += BAND_ROWS) {
+    int16_t bandEnd = min((int16_t)(bandY + BAND_ROWS), _height);
+    int16_t x0 = _width;
+    int16_t x1 = -1;
+    int16_t y0 = -1;
+    int16_t y1 = -1;
+
+    for (int16_t y = bandY; y < bandEnd; y++) {
+      const uint16_t *back = _framebuffer + (size_t)y * _width;
+      const uint16_t *front = _front + (size_t)y * _width;
+
+      int16_t left = 0;
+      while (left < _width && back[left] == front[left]) left++;
+      if (left == _width) continue;
+
+      int16_t right = _width - 1;
+      while (back[right] == front[right]) right--;
+
+      if (left < x0) x0 = left;
+      if (right > x1) x1 = right;
+      if (y0 < 0) y0 = y;
+      y1 = y;
+    }
+
+    if (x1 >= 0) {
+      pushRect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+    }
+  }
+}
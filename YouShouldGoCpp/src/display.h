@@ -0,0 +1,29 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+// display.h declares the off-screen canvas that only pushes changed pixels to the panel
+
+// Draws into a PSRAM framebuffer like Arduino_Canvas, but keeps a second
+// copy of what the panel currently shows. flush() diffs the two in bands of
+// rows and sends only the bounding rectangle of the changed pixels in each
+// band, so screens can keep doing fillScreen() + full redraw without the
+// whole 320x170 frame going over the parallel bus.
+class DiffCanvas : public Arduino_Canvas {
+public:
+  DiffCanvas(int16_t w, int16_t h, Arduino_G *output);
+
+  bool begin(int32_t speed = GFX_NOT_DEFINED) override;
+  void flush() override;
+
+  // Pixels sent to the panel by the last flush()
+  uint32_t lastFlushPixels() const { return _lastFlushPixels; }
+
+private:
+  static const int BAND_ROWS = 8;
+
+  void pushRect(int16_t x, int16_t y, int16_t w, int16_t h);
+
+  uint16_t *_front = nullptr;  // what the panel shows
+  uint16_t *_scratch = nullptr;  // contiguous copy of one dirty rectangle
+  uint32_t _lastFlushPixels = 0;
+};
@@ -0,0 +1,158 @@
+#include "fastwifi.h"
+#include "kvstore.h"
+#include "tasks.h"
+#include "diag.h"
+#include <limits.h>
+
+#define WIFI_HINT_KEY "wifi_ap"
+#define WIFI_WAIT_STEP_MS 50
+
+struct __attribute__((packed)) WiFiHint {
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+};
+
+static WiFiHint hint = {};
+static bool hintValid = false;
+static bool scanning = false;    // this attempt fell back from the remembered access point
+static unsigned long attemptAt = 0;
+static unsigned long retryAt = 0;
+static unsigned long backoffMs = WIFI_BACKOFF_MIN_MS;
+static unsigned long lostAt = 0;
+
+// WiFi event task, the UI loop reads the state in wifiTick()
+static void onWiFiEvent(WiFiEvent_t event) {
+  if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP || event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    wakeUi();
+  }
+}
+
+static void beginAttempt(unsigned long now) {
+  wifiLink = WIFI_LINK_CONNECTING;
+  attemptAt = now;
+  scanning = !hintValid;
+
+  if (hintValid) {
+    Serial.println("[WIFI] Connecting to the last access point, channel " + String(hint.channel));
+    WiFi.begin(ssid, password, hint.channel, hint.bssid);
+  } else {
+    Serial.println("[WIFI] Connecting, scanning for " + String(ssid));
+    WiFi.begin(ssid, password);
+  }
+}
+
+void wifiStart() {
+  WiFi.persistent(false);       // the hint replaces the SDK's own copy in flash
+  WiFi.setAutoReconnect(false); // the supervisor paces the retries
+  WiFi.mode(WIFI_STA);
+  WiFi.onEvent(onWiFiEvent);
+
+#ifdef STATIC_IP
+  IPAddress ip, gateway, subnet, dns;
+  ip.fromString(STATIC_IP);
+  gateway.fromString(STATIC_GATEWAY);
+  subnet.fromString(STATIC_SUBNET);
+  dns.fromString(STATIC_DNS);
+  WiFi.config(ip, gateway, subnet, dns);
+#endif
+
+  std::vector<uint8_t> blob;
+  hintValid = kvStore->getBlob(WIFI_HINT_KEY, blob) && blob.size() == sizeof(hint);
+  if (hintValid) {
+    memcpy(&hint, blob.data(), sizeof(hint));
+  }
+  beginAttempt(millis());
+}
+
+// Kept only when it changed, a flash write per connection is not needed
+static void saveHint() {
+  WiFiHint current = {};
+  memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+  current.channel = WiFi.channel();
+  if (hintValid && memcmp(&current, &hint, sizeof(hint)) == 0) return;
+
+  std::vector<uint8_t> blob((const uint8_t *)&current, (const uint8_t *)&current + sizeof(current));
+  if (kvStore->setBlob(WIFI_HINT_KEY, blob)) {
+    hint = current;
+    hintValid = true;
+  }
+}
+
+static void backOff(unsigned long now) {
+  WiFi.disconnect();
+  wifiLink = WIFI_LINK_DOWN;
+  retryAt = now + backoffMs + random(backoffMs / 4 + 1);
+  Serial.println("[WIFI] Retrying in " + String((retryAt - now) / 1000) + " s");
+  backoffMs = min(backoffMs * 2, (unsigned long)WIFI_BACKOFF_MAX_MS);
+}
+
+bool wifiTick(unsigned long now) {
+  bool connected = WiFi.status() == WL_CONNECTED;
+
+  switch (wifiLink) {
+    case WIFI_LINK_UP:
+      if (!connected) {
+        lostAt = now;
+        Serial.println("[WIFI] Link lost");
+        // The first retry is straight away, a dropped beacon is the usual cause
+        backoffMs = WIFI_BACKOFF_MIN_MS;
+        beginAttempt(now);
+      }
+      return false;
+
+    case WIFI_LINK_CONNECTING:
+      if (connected) {
+        wifiLink = WIFI_LINK_UP;
+        backoffMs = WIFI_BACKOFF_MIN_MS;
+        diagBootMark(DIAG_BOOT_WIFI);
+        Serial.println("[WIFI] Connected in " + String(now - attemptAt) + " ms" +
+                       (scanning ? "" : ", remembered access point") + ", IP " + WiFi.localIP().toString() +
+                       (lostAt ? ", down " + String((now - lostAt) / 1000) + " s" : ""));
+        lostAt = 0;
+        saveHint();
+        return true;
+      }
+      if (!scanning && now - attemptAt >= WIFI_FAST_TIMEOUT_MS) {
+        scanning = true;
+        Serial.println("[WIFI] Last access point did not answer, scanning");
+        WiFi.disconnect();
+        WiFi.begin(ssid, password);
+      } else if (now - attemptAt >= WIFI_CONNECT_TIMEOUT_MS) {
+        Serial.println("[WIFI] Not connected after " + String(WIFI_CONNECT_TIMEOUT_MS / 1000) + " s");
+        backOff(now);
+      }
+      return false;
+
+    case WIFI_LINK_DOWN:
+      if ((long)(now - retryAt) >= 0) {
+        beginAttempt(now);
+      }
+      return false;
+  }
+  return false;
+}
+
+unsigned long wifiMsUntilTick(unsigned long now) {
+  long due;
+  switch (wifiLink) {
+    case WIFI_LINK_CONNECTING:
+      due = (long)(attemptAt + (scanning ? WIFI_CONNECT_TIMEOUT_MS : WIFI_FAST_TIMEOUT_MS) - now);
+      break;
+    case WIFI_LINK_DOWN:
+      due = (long)(retryAt - now);
+      break;
+    default:
+      return ULONG_MAX;  // a disconnect event wakes the UI
+  }
+  return due > 0 ? due : 0;
+}
+
+bool wifiWaitConnected(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED) {
+    if (wifiLink == WIFI_LINK_DOWN || millis() - start >= timeoutMs) return false;
+    delay(WIFI_WAIT_STEP_MS);
+  }
+  return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+// fastwifi.h declares the WiFi supervisor
+//
+// Nothing waits for WiFi. setup() only starts the association and the
+// screens come from the NVS caches meanwhile. The access point that answered
+// last time (BSSID and channel, kept under "wifi_ap") is tried first, which
+// skips the scan. If it does not answer within WIFI_FAST_TIMEOUT_MS the usual
+// scan follows. With STATIC_IP (app.h) DHCP is skipped too.
+//
+// The link state lives in wifiLink and changes in the UI loop only. WiFi
+// events just wake the loop. A lost link or a failed attempt is retried
+// after WIFI_BACKOFF_MIN_MS, doubling up to WIFI_BACKOFF_MAX_MS, with some
+// jitter so that units sharing an access point do not retry in step.
+
+#define WIFI_FAST_TIMEOUT_MS 3000     // the remembered access point gets this long
+#define WIFI_CONNECT_TIMEOUT_MS 15000 // an attempt, scan included
+#define WIFI_BACKOFF_MIN_MS 2000
+#define WIFI_BACKOFF_MAX_MS 60000
+#define NET_WIFI_WAIT_MS 10000        // how long a request waits for an attempt in progress
+
+// UI task
+void wifiStart();
+// Runs the state machine, true when the link came up in this call
+bool wifiTick(unsigned long now);
+unsigned long wifiMsUntilTick(unsigned long now);
+
+// Network tasks: true once connected. Waits while an attempt is in progress
+// (at most timeoutMs), gives up at once while the supervisor backs off.
+bool wifiWaitConnected(unsigned long timeoutMs);
@@ -0,0 +1,77 @@
+#include "kvstore.h"
+
+// Strings and integers are kept as bytes like blobs, NVS keeps them apart
+// by type but the cache code never reuses a key across types
+
+bool MemoryKvStore::getBlob(const char *key, std::vector<uint8_t> &out) {
+  auto it = _values.find(key);
+  if (it == _values.end()) return false;
+  out = it->second;
+  return true;
+}
+
+// The old value is replaced, so it does not count against the new one
+bool MemoryKvStore::fits(const char *key, size_t size) const {
+  if (_capacity == 0) return true;
+  auto it = _values.find(key);
+  size_t replaced = it != _values.end() ? it->second.size() : 0;
+  return bytesStored() - replaced + size <= _capacity;
+}
+
+bool MemoryKvStore::setBlob(const char *key, const std::vector<uint8_t> &data) {
+  if (!fits(key, data.size())) return false;
+  _values[key] = data;
+  return true;
+}
+
+bool MemoryKvStore::getString(const char *key, String &out) {
+  auto it = _values.find(key);
+  if (it == _values.end() || it->second.empty()) return false;
+  out = String((const char *)it->second.data());
+  return true;
+}
+
+bool MemoryKvStore::setString(const char *key, const String &value) {
+  if (!fits(key, value.length() + 1)) return false;
+  const char *s = value.c_str();
+  _values[key] = std::vector<uint8_t>(s, s + value.length() + 1);
+  return true;
+}
+
+bool MemoryKvStore::getU32(const char *key, uint32_t &out) {
+  auto it = _values.find(key);
+  if (it == _values.end() || it->second.size() != sizeof(uint32_t)) return false;
+  memcpy(&out, it->second.data(), sizeof(uint32_t));
+  return true;
+}
+
+bool MemoryKvStore::setU32(const char *key, uint32_t value) {
+  if (!fits(key, sizeof(value))) return false;
+  const uint8_t *p = (const uint8_t *)&value;
+  _values[key] = std::vector<uint8_t>(p, p + sizeof(value));
+  return true;
+}
+
+void MemoryKvStore::erase(const char *key) {
+  _values.erase(key);
+}
+
+bool MemoryKvStore::eraseAll() {
+  _values.clear();
+  return true;
+}
+
+bool MemoryKvStore::freeBytes(size_t &free) {
+  if (_capacity == 0) return false;
+  size_t used = bytesStored();
+  free = used < _capacity ? _capacity - used : 0;
+  return true;
+}
+
+size_t MemoryKvStore::bytesStored() const {
+  size_t total = 0;
+  for (const auto &entry : _values) {
+    total += entry.second.size();
+  }
+  return total;
+}
@@ -0,0 +1,84 @@
+#pragma once
+//pragma to only include once
+#include <Arduino.h>
+#include <vector>
+#include <map>
+// kvstore.h declares the key-value storage behind the catalog caches
+//
+// The device keeps its caches in the "transit" NVS namespace (NvsKvStore,
+// kvstore_nvs.cpp). MemoryKvStore holds the same keys in RAM so the cache
+// code can run in the native build. Writes are committed before they return.
+
+class KvStore {
+public:
+  virtual ~KvStore() {}
+
+  virtual bool begin() = 0;
+  // Returns false if the key is missing or unreadable
+  virtual bool getBlob(const char *key, std::vector<uint8_t> &out) = 0;
+  virtual bool setBlob(const char *key, const std::vector<uint8_t> &data) = 0;
+  virtual bool getString(const char *key, String &out) = 0;
+  virtual bool setString(const char *key, const String &value) = 0;
+  virtual bool getU32(const char *key, uint32_t &out) = 0;
+  virtual bool setU32(const char *key, uint32_t value) = 0;
+  virtual void erase(const char *key) = 0;
+  virtual bool eraseAll() = 0;
+  // Bytes still free where the namespace lives, false if unknown
+  virtual bool freeBytes(size_t &free) = 0;
+};
+
+// A capacity other than 0 makes writes fail once the values would exceed it,
+// like NVS running out of pages
+class MemoryKvStore : public KvStore {
+public:
+  explicit MemoryKvStore(size_t capacity = 0) : _capacity(capacity) {}
+
+  bool begin() override { return true; }
+  bool getBlob(const char *key, std::vector<uint8_t> &out) override;
+  bool setBlob(const char *key, const std::vector<uint8_t> &data) override;
+  bool getString(const char *key, String &out) override;
+  bool setString(const char *key, const String &value) override;
+  bool getU32(const char *key, uint32_t &out) override;
+  bool setU32(const char *key, uint32_t value) override;
+  void erase(const char *key) override;
+  bool eraseAll() override;
+  bool freeBytes(size_t &free) override;
+
+  size_t bytesStored() const;
+
+private:
+  bool fits(const char *key, size_t size) const;
+
+  size_t _capacity;
+  std::map<String, std::vector<uint8_t>> _values;
+};
+
+#ifdef ARDUINO
+#include <nvs.h>
+
+class NvsKvStore : public KvStore {
+public:
+  explicit NvsKvStore(const char *ns) : _namespace(ns) {}
+
+  bool begin() override;
+  bool getBlob(const char *key, std::vector<uint8_t> &out) override;
+  bool setBlob(const char *key, const std::vector<uint8_t> &data) override;
+  bool getString(const char *key, String &out) override;
+  bool setString(const char *key, const String &value) override;
+  bool getU32(const char *key, uint32_t &out) override;
+  bool setU32(const char *key, uint32_t value) override;
+  void erase(const char *key) override;
+  bool eraseAll() override;
+  bool freeBytes(size_t &free) override;
+
+private:
+  bool open();
+  bool commit();
+
+  const char *_namespace;
+  nvs_handle_t _handle = 0;
+};
+#endif
+
+// The store the catalog caches live in, defined in main.cpp
+extern KvStore *kvStore;
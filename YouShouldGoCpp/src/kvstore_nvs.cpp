@@ -0,0 +1,182 @@
+#ifdef ARDUINO
+#include "kvstore.h"
+#include <nvs_flash.h>
+
+#define NVS_ENTRY_SIZE 32
+
+static const char* getNVSErrorString(esp_err_t err) {
+  switch (err) {
+    case ESP_OK:
+      return "OK";
+    case ESP_ERR_NVS_NOT_FOUND:
+      return "NOT_FOUND";
+    case ESP_ERR_NVS_NOT_ENOUGH_SPACE:
+      return "NOT_ENOUGH_SPACE";
+    case ESP_ERR_NVS_INVALID_HANDLE:
+      return "INVALID_HANDLE";
+    case ESP_ERR_NVS_INVALID_NAME:
+      return "INVALID_NAME";
+    case ESP_ERR_NVS_INVALID_LENGTH:
+      return "INVALID_LENGTH";
+    case ESP_ERR_NVS_NOT_INITIALIZED:
+      return "NOT_INITIALIZED";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+bool NvsKvStore::begin() {
+  Serial.println("[NVS] Initializing NVS...");
+  esp_err_t err = nvs_flash_init();
+  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    Serial.println("[NVS] NVS flash corrupted, erasing...");
+    nvs_flash_erase();
+    nvs_flash_init();
+  }
+  bool ok = open();
+  Serial.println("[NVS] NVS ready");
+  return ok;
+}
+
+bool NvsKvStore::open() {
+  if (_handle) return true;
+
+  Serial.println("[NVS] Opening namespace '" + String(_namespace) + "'...");
+  esp_err_t err = nvs_open(_namespace, NVS_READWRITE, &_handle);
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_open failed: " + String(getNVSErrorString(err)));
+    _handle = 0;
+    return false;
+  }
+  Serial.println("[NVS] Namespace opened successfully");
+  return true;
+}
+
+bool NvsKvStore::commit() {
+  esp_err_t err = nvs_commit(_handle);
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_commit failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+  return true;
+}
+
+bool NvsKvStore::getBlob(const char *key, std::vector<uint8_t> &out) {
+  if (!open()) return false;
+
+  size_t required_size = 0;
+  esp_err_t err = nvs_get_blob(_handle, key, NULL, &required_size);
+
+  if (err == ESP_ERR_NVS_NOT_FOUND) {
+    return false;
+  }
+
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_get_blob (size check) failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+
+  Serial.println("[NVS] Blob '" + String(key) + "' size: " + String(required_size) + " bytes");
+
+  out.resize(required_size);
+  err = nvs_get_blob(_handle, key, out.data(), &required_size);
+
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_get_blob (read) failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+  return true;
+}
+
+bool NvsKvStore::setBlob(const char *key, const std::vector<uint8_t> &data) {
+  if (!open()) return false;
+
+  esp_err_t err = nvs_set_blob(_handle, key, (const void*)data.data(), data.size());
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_set_blob failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+
+  Serial.println("[NVS] nvs_set_blob succeeded, committing to flash...");
+  return commit();
+}
+
+bool NvsKvStore::getString(const char *key, String &out) {
+  if (!open()) return false;
+
+  size_t len = 0;
+  if (nvs_get_str(_handle, key, NULL, &len) != ESP_OK || len == 0) {
+    return false;
+  }
+
+  std::vector<char> buf(len);
+  if (nvs_get_str(_handle, key, buf.data(), &len) != ESP_OK) {
+    return false;
+  }
+  out = String(buf.data());
+  return true;
+}
+
+bool NvsKvStore::setString(const char *key, const String &value) {
+  if (!open()) return false;
+
+  esp_err_t err = nvs_set_str(_handle, key, value.c_str());
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_set_str " + String(key) + " failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+  return commit();
+}
+
+bool NvsKvStore::getU32(const char *key, uint32_t &out) {
+  return open() && nvs_get_u32(_handle, key, &out) == ESP_OK;
+}
+
+bool NvsKvStore::setU32(const char *key, uint32_t value) {
+  if (!open()) return false;
+
+  esp_err_t err = nvs_set_u32(_handle, key, value);
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_set_u32 " + String(key) + " failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+  return commit();
+}
+
+void NvsKvStore::erase(const char *key) {
+  if (open() && nvs_erase_key(_handle, key) == ESP_OK) {
+    commit();
+  }
+}
+
+bool NvsKvStore::eraseAll() {
+  if (!open()) return false;
+
+  Serial.println("[NVS] Clearing all NVS data...");
+  esp_err_t err = nvs_erase_all(_handle);
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_erase_all failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+
+  // Commit to write changes to flash
+  if (!commit()) return false;
+  Serial.println("[NVS] NVS cleared and committed successfully");
+  return true;
+}
+
+// NVS stores everything in 32 byte entries, blobs take one per 32 bytes of
+// data plus their headers. The partition is shared by all namespaces (WiFi
+// calibration, the access point hint), its free entries are what is left
+// for any of them.
+bool NvsKvStore::freeBytes(size_t &free) {
+  nvs_stats_t stats;
+  esp_err_t err = nvs_get_stats(NULL, &stats);
+  if (err != ESP_OK) {
+    Serial.println("[NVS] ERROR: nvs_get_stats failed: " + String(getNVSErrorString(err)));
+    return false;
+  }
+  free = stats.free_entries * NVS_ENTRY_SIZE;
+  return true;
+}
+#endif
@@ -0,0 +1,281 @@
+#include "localstatus.h"
+#include <algorithm>
+
+#define METRES_PER_DEGREE 111195.0f  // along a meridian, 6371 km earth radius
+
+void TripStops::assign(std::vector<StopPoint> &stops) {
+  _stops.swap(stops);
+  std::sort(_stops.begin(), _stops.end(), [](const StopPoint &a, const StopPoint &b) {
+    return a.sequence < b.sequence;
+  });
+
+  // One origin and one cos for the whole trip, a city spans a fraction of a degree
+  _lat0 = _stops.empty() ? 0 : _stops[0].lat;
+  _lon0 = _stops.empty() ? 0 : _stops[0].lon;
+  _lonScale = cosf(_lat0 * (float)(M_PI / 180.0));
+
+  _x.resize(_stops.size());
+  _y.resize(_stops.size());
+  _along.resize(_stops.size());
+  for (size_t i = 0; i < _stops.size(); i++) {
+    toMetres(_stops[i].lat, _stops[i].lon, _x[i], _y[i]);
+    _along[i] = i == 0 ? 0 : _along[i - 1] + hypotf(_x[i] - _x[i - 1], _y[i] - _y[i - 1]);
+  }
+}
+
+void TripStops::clear() {
+  _stops.clear();
+  _x.clear();
+  _y.clear();
+  _along.clear();
+}
+
+void TripStops::toMetres(float lat, float lon, float &x, float &y) const {
+  x = (lon - _lon0) * _lonScale * METRES_PER_DEGREE;
+  y = (lat - _lat0) * METRES_PER_DEGREE;
+}
+
+int TripStops::nearest(float lat, float lon) const {
+  float x, y;
+  toMetres(lat, lon, x, y);
+
+  int best = -1;
+  float bestDistance = 0;
+  for (size_t i = 0; i < _stops.size(); i++) {
+    float dx = _x[i] - x;
+    float dy = _y[i] - y;
+    // Squared, only ever compared
+    float distance = dx * dx + dy * dy;
+    if (best < 0 || distance < bestDistance) {
+      best = i;
+      bestDistance = distance;
+    }
+  }
+  return best;
+}
+
+// Squared distance from x/y to the segment, along is where the foot of the
+// perpendicular (clamped to the segment) lies on the route
+float TripStops::project(int segment, float x, float y, float &along) const {
+  float dx = _x[segment + 1] - _x[segment];
+  float dy = _y[segment + 1] - _y[segment];
+  float length2 = dx * dx + dy * dy;
+
+  float t = length2 > 0 ? ((x - _x[segment]) * dx + (y - _y[segment]) * dy) / length2 : 0;
+  t = std::max(0.0f, std::min(1.0f, t));
+
+  along = _along[segment] + t * (_along[segment + 1] - _along[segment]);
+  float ex = x - (_x[segment] + t * dx);
+  float ey = y - (_y[segment] + t * dy);
+  return ex * ex + ey * ey;
+}
+
+int TripStops::locate(float lat, float lon, int hint, float &along) const {
+  along = 0;
+  if (_stops.size() < 2) {
+    return _stops.empty() ? -1 : 0;
+  }
+
+  float x, y;
+  toMetres(lat, lon, x, y);
+
+  int last = _stops.size() - 2;
+  int from = 0;
+  int to = last;
+  if (hint >= 0) {
+    from = std::max(0, hint - TRACK_SEARCH_SEGMENTS);
+    to = std::min(last, hint + TRACK_SEARCH_SEGMENTS);
+  }
+
+  int best = from;
+  float bestDistance = project(from, x, y, along);
+  for (int segment = from + 1; segment <= to; segment++) {
+    float segmentAlong;
+    float distance = project(segment, x, y, segmentAlong);
+    if (distance < bestDistance) {
+      best = segment;
+      bestDistance = distance;
+      along = segmentAlong;
+    }
+  }
+
+  // Not near where it was, it jumped (a data gap) or the hint is wrong
+  if (hint >= 0 && bestDistance > TRACK_MAX_OFFSET_M * TRACK_MAX_OFFSET_M && (from > 0 || to < last)) {
+    return locate(lat, lon, -1, along);
+  }
+  return best;
+}
+
+int TripStops::stopAt(int segment, float along) const {
+  if (_stops.size() < 2) return 0;
+  return along < (_along[segment] + _along[segment + 1]) / 2 ? segment : segment + 1;
+}
+
+void VehicleTracker::clear() {
+  memset(_tracks, 0, sizeof(_tracks));
+  for (VehicleTrack &track : _tracks) {
+    track.segment = -1;
+  }
+  _generation = 0;
+}
+
+// At most VEHICLE_FEED_TRIP_MAX vehicles are seen per trip, so a slot not touched
+// in this generation is always there to take over
+VehicleTrack &VehicleTracker::track(int32_t id) {
+  VehicleTrack *oldest = &_tracks[0];
+  for (VehicleTrack &track : _tracks) {
+    if (track.generation != 0 && track.id == id) {
+      track.generation = _generation;
+      return track;
+    }
+    if (track.generation < oldest->generation) {
+      oldest = &track;
+    }
+  }
+
+  memset(oldest, 0, sizeof(*oldest));
+  oldest->id = id;
+  oldest->segment = -1;
+  oldest->generation = _generation;
+  return *oldest;
+}
+
+static int32_t readI32(const uint8_t *p) {
+  int32_t value;
+  memcpy(&value, p, sizeof(value));  // little endian like the ESP32
+  return value;
+}
+
+bool decodeVehicleFeed(const uint8_t *data, size_t len, VehicleFeed &out) {
+  out.count = 0;
+  if (len < VEHICLE_FEED_HEADER_SIZE || data[0] != VEHICLE_FEED_VERSION) {
+    return false;
+  }
+
+  size_t count = data[1];
+  if (count > VEHICLE_FEED_MAX || len < VEHICLE_FEED_HEADER_SIZE + count * VEHICLE_FEED_RECORD_SIZE) {
+    return false;
+  }
+
+  out.dataTimestamp = (uint32_t)readI32(data + 4);
+  // Each watch tracks VEHICLE_FEED_TRIP_MAX vehicles, more on one trip are dropped
+  uint8_t perTrip[STATUS_BATCH_MAX] = {};
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t *record = data + VEHICLE_FEED_HEADER_SIZE + i * VEHICLE_FEED_RECORD_SIZE;
+    uint16_t speed;
+    memcpy(&speed, record + 12, sizeof(speed));
+    uint8_t trip = record[14];
+    if (trip >= STATUS_BATCH_MAX) {
+      return false;
+    }
+    if (perTrip[trip] >= VEHICLE_FEED_TRIP_MAX) continue;
+    perTrip[trip]++;
+
+    VehiclePosition &vehicle = out.vehicles[kept++];
+    vehicle.id = readI32(record);
+    vehicle.lat = readI32(record + 4) / 1e6f;
+    vehicle.lon = readI32(record + 8) / 1e6f;
+    vehicle.speed = speed / 36.0f;  // 0.1 km/h steps
+    vehicle.trip = trip;
+  }
+  out.count = kept;
+  return true;
+}
+
+// Follows the vehicle from its last position. The smoothed speed along the
+// route includes the time spent at stops, which the reported speed does not.
+static float trackVehicle(const TripStops &stops, const VehiclePosition &vehicle, uint32_t now,
+                          VehicleTrack &track, int &segment, float &along) {
+  segment = stops.locate(vehicle.lat, vehicle.lon, track.segment, along);
+
+  if (track.segment < 0) {
+    track.segment = segment;
+    track.along = along;
+    track.seenAt = now;
+  } else if (now > track.seenAt) {
+    float sample = (along - track.along) / (now - track.seenAt);
+    // GPS jitter moves a waiting tram backwards, that is not a speed
+    if (sample >= 0) {
+      track.speed = track.speed > 0 ? track.speed + ETA_SMOOTHING * (sample - track.speed) : sample;
+    }
+    track.segment = segment;
+    track.along = along;
+    track.seenAt = now;
+  }
+
+  if (track.speed >= ETA_MIN_SPEED_MPS) return track.speed;
+  if (vehicle.speed >= ETA_MIN_SPEED_MPS) return vehicle.speed;
+  return ETA_TYPICAL_SPEED_MPS;
+}
+
+// As displayStatus() rounds it
+static int etaMinutes(uint16_t etaS) {
+  return (etaS + 30) / 60;
+}
+
+static bool before(const CompactVehicle &a, int stopsAway, uint16_t etaS) {
+  return a.stopsAway < stopsAway || (a.stopsAway == stopsAway && a.etaS <= etaS);
+}
+
+// Same rules as TramOrientationService.getTramStatus(), constant work per
+// vehicle once it is tracked
+void computeStatus(const TripStops &stops, int userStop, const VehicleFeed &feed, uint8_t trip,
+                   VehicleTracker &tracker, const CompactStatus &previous, CompactStatus &out) {
+  memset(&out, 0, sizeof(out));
+  out.version = COMPACT_STATUS_VERSION;
+  out.dataTimestamp = feed.dataTimestamp;
+
+  if (stops.empty()) {
+    out.state = TRAM_MAP_ERROR;
+  } else if (userStop < 0 || userStop >= (int)stops.size()) {
+    out.state = TRAM_NO_STATION;
+  } else {
+    int32_t userSequence = stops[userStop].sequence;
+    float userAlong = stops.along(userStop);
+    out.flags = COMPACT_STATUS_HAS_ETA;
+    tracker.nextGeneration();
+
+    for (uint8_t i = 0; i < feed.count; i++) {
+      const VehiclePosition &vehicle = feed.vehicles[i];
+      if (vehicle.trip != trip) continue;
+
+      int segment;
+      float along;
+      float speed = trackVehicle(stops, vehicle, feed.dataTimestamp, tracker.track(vehicle.id), segment, along);
+
+      int stopsAway = userSequence - stops[stops.stopAt(segment, along)].sequence;
+      if (stopsAway < 0) continue;  // already past the user
+
+      float remaining = std::max(0.0f, userAlong - along);
+      uint16_t etaS = (uint16_t)std::min(remaining / speed, (float)ETA_MAX_S);
+
+      // Nearest first, kept sorted by insertion
+      int slot = out.count;
+      while (slot > 0 && !before(out.vehicles[slot - 1], stopsAway, etaS)) slot--;
+      if (slot >= COMPACT_STATUS_MAX_VEHICLES) continue;
+
+      int last = std::min((int)out.count, COMPACT_STATUS_MAX_VEHICLES - 1);
+      for (int j = last; j > slot; j--) {
+        out.vehicles[j] = out.vehicles[j - 1];
+      }
+      out.vehicles[slot].vehicleId = vehicle.id;
+      out.vehicles[slot].stopsAway = stopsAway;
+      out.vehicles[slot].etaS = etaS;
+      if (out.count < COMPACT_STATUS_MAX_VEHICLES) out.count++;
+    }
+    out.state = out.count > 0 ? TRAM_APPROACHING : TRAM_ALL_PASSED;
+  }
+
+  bool changed = previous.version == 0 || previous.state != out.state || previous.flags != out.flags ||
+                 previous.count != out.count;
+  // The estimate moves a little with every feed, only the minute the screen
+  // shows counts as a change
+  for (int i = 0; i < out.count && !changed; i++) {
+    const CompactVehicle &was = previous.vehicles[i];
+    const CompactVehicle &now = out.vehicles[i];
+    changed = was.vehicleId != now.vehicleId || was.stopsAway != now.stopsAway ||
+              etaMinutes(was.etaS) != etaMinutes(now.etaS);
+  }
+  out.seq = changed ? previous.seq + 1 : previous.seq;
+}
@@ -0,0 +1,117 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include "compactstatus.h"
+// localstatus.h declares the on-device status computation
+//
+// Instead of a finished status the device fetches only the positions of the
+// watched trips' vehicles (/api/vehicles/compact, mirrors CompactVehicles.java)
+// and works out the same CompactStatus the backend would. Each vehicle is
+// projected onto the trip's polyline of stops, which gives both its nearest
+// stop (for stops away) and how far along the route it is (for the arrival
+// estimate). Distances are equirectangular, exact enough within a city and
+// without any trigonometry per vehicle. Nothing here touches the network.
+
+#define VEHICLE_FEED_VERSION 3
+#define VEHICLE_FEED_HEADER_SIZE 8
+#define VEHICLE_FEED_RECORD_SIZE 16
+#define VEHICLE_FEED_TRIP_MAX 16  // vehicles per trip, the backend drops the rest
+#define VEHICLE_FEED_MAX 128      // 8 watched trips
+
+// A tracked vehicle is only searched for this many segments around where it
+// was last time, unless it turns up further than TRACK_MAX_OFFSET_M off them
+#define TRACK_SEARCH_SEGMENTS 2
+#define TRACK_MAX_OFFSET_M 150.0f
+
+#define ETA_SMOOTHING 0.3f             // weight of a new speed sample
+#define ETA_MIN_SPEED_MPS 1.5f         // below this a speed says nothing about arrival
+#define ETA_TYPICAL_SPEED_MPS 5.0f     // 18 km/h, a city tram including its stops
+#define ETA_MAX_S 65535
+
+struct StopPoint {
+  int32_t sequence;
+  float lat;
+  float lon;
+};
+
+struct VehiclePosition {
+  int32_t id;
+  float lat;
+  float lon;
+  float speed;  // m/s as reported by the vehicle, 0 when stopped or unknown
+  uint8_t trip; // index of its trip in the request
+};
+
+struct VehicleFeed {
+  uint32_t dataTimestamp;  // unix seconds when the backend read the positions
+  uint8_t count;
+  VehiclePosition vehicles[VEHICLE_FEED_MAX];
+};
+
+// A trip's stops in sequence order, with the distance along the
+// route from the first stop to each of them
+class TripStops {
+public:
+  void assign(std::vector<StopPoint> &stops);
+  void clear();
+  bool empty() const { return _stops.empty(); }
+  size_t size() const { return _stops.size(); }
+  const StopPoint &operator[](size_t index) const { return _stops[index]; }
+  float along(size_t index) const { return _along[index]; }
+
+  // Index of the stop closest to lat/lon, -1 when there are none
+  int nearest(float lat, float lon) const;
+
+  // Projects lat/lon onto the nearest segment (stop i to i + 1) and returns
+  // i, with the metres from the first stop in along. A hint >= 0 (the
+  // segment found last time) limits the search to the segments around it.
+  int locate(float lat, float lon, int hint, float &along) const;
+
+  // The stop a position along the route is closest to
+  int stopAt(int segment, float along) const;
+
+private:
+  void toMetres(float lat, float lon, float &x, float &y) const;
+  float project(int segment, float x, float y, float &along) const;
+
+  std::vector<StopPoint> _stops;
+  std::vector<float> _x;      // stop positions in metres from the first stop
+  std::vector<float> _y;
+  std::vector<float> _along;  // cumulative distance along the route
+  float _lat0 = 0;
+  float _lon0 = 0;
+  float _lonScale = 1;        // cos of the trip's latitude, shrinks longitude to distance
+};
+
+// Where each vehicle was on the previous polls, for the smoothed speed and
+// to find it again without searching the whole trip
+struct VehicleTrack {
+  int32_t id;
+  int16_t segment;       // -1 for an unused slot
+  uint32_t seenAt;       // dataTimestamp of the feed it was last seen in
+  uint32_t generation;   // computeStatus() call that last touched it
+  float along;
+  float speed;           // smoothed m/s along the route, 0 until known
+};
+
+class VehicleTracker {
+public:
+  VehicleTracker() { clear(); }
+  void clear();
+  void nextGeneration() { _generation++; }
+  // The vehicle's track, a fresh one (segment -1) if it was not tracked
+  VehicleTrack &track(int32_t id);
+
+private:
+  VehicleTrack _tracks[VEHICLE_FEED_TRIP_MAX];
+  uint32_t _generation = 0;
+};
+
+bool decodeVehicleFeed(const uint8_t *data, size_t len, VehicleFeed &out);
+
+// Status of userStop from the feed's vehicles on trip (their index in the
+// request). previous is the last status computed (version 0 if none), its
+// seq is kept unless the state or the approaching vehicles change. Sets
+// COMPACT_STATUS_HAS_ETA with an arrival estimate for every vehicle.
+void computeStatus(const TripStops &stops, int userStop, const VehicleFeed &feed, uint8_t trip,
+                   VehicleTracker &tracker, const CompactStatus &previous, CompactStatus &out);
@@ -1,313 +1,782 @@
 #include "app.h"
 #include "utils.h"
+#include "tasks.h"
+#include "buttons.h"
+#include "standby.h"
+#include "statuspoll.h"
+#include "statusstream.h"
+#include "diag.h"
+#include "kvstore.h"
+#include "cacheindex.h"
+#include "pipelinebench.h"
+#include "watchlist.h"
+#include "fastwifi.h"
+#include <limits.h>
+#include <time.h>
 
 const char* ssid = WIFI_SSID;
 const char* password = WIFI_PASS;
-const char* serverUrl = "https://youshouldgo.onrender.com";
+const char* serverUrl = SERVER_URL;
 
-#define BTN_NEXT 14
-#define BTN_SELECT 0
+#define TIMEZONE "EET-2EEST,M3.5.0/3,M10.5.0/4"  // Cluj, same as the hardcoded agency
+#define WARM_IDLE_MS 500   // resting on a route or trip this long warms its next screen
+#define WARM_NEIGHBORS 1   // entries on each side warmed along with the highlighted one
 
-std::vector<Route> routes;
+ListWindow<Route> routes;
 int currentRouteIndex = 0;
 bool routesLoaded = false;
 
-std::vector<Trip> trips;
+ListWindow<Trip> trips;
 int currentTripIndex = 0;
 bool tripsLoaded = false;
 
-std::vector<Station> stations;
+ListWindow<Station> stations;
 int currentStationIndex = 0;
 bool stationsLoaded = false;
-unsigned long lastButtonPress = 0;
-const unsigned long DEBOUNCE_DELAY = 200;
-const unsigned long LONG_PRESS_MS = 800;
-const unsigned long CLEAR_NVS_PRESS_MS = 10000;
-const unsigned long STATUS_POLL_INTERVAL = 2000;
 Screen currentScreen = SCREEN_ROUTES;
+volatile WifiLink wifiLink = WIFI_LINK_CONNECTING;
+
+unsigned long nextStatusPoll = 0;
+CompactStatus lastStatus = {};  // version 0 until the first status arrives, the most urgent watch's
+bool statusInFlight = false;
+uint32_t statusPollSeq = 0;    // seq of the last status poll posted
+uint32_t staleStatusSeq = 0;   // polls up to this seq were for an older watchlist
+
+Watchlist watchlist;
+StatusBatch lastBatch = {};     // statuses of the watchlist, count 0 until the first poll
+int watchCursor = -1;           // highlighted row of the status screen, -1 for none
+char selectedTripId[WATCH_TRIP_ID_LEN] = "";  // empty lists the backend's selected trip
+char selectedRouteName[WATCH_ROUTE_NAME_LEN] = "";
+
+uint32_t uiAwaitingSeq = 0;
+uint32_t prefetchSeq = 0;  // background page load, one at a time
+bool warmPosted = false;   // the highlighted entry's warming is queued, until the next button
+std::function<void()> deferredAction = nullptr;
+unsigned long deferredAt = 0;
+const unsigned long MESSAGE_HOLD_MS = 2000;
+
+bool clearPopupShown = false;
+bool clearDone = false;
+
+// SELECT held while NEXT is pressed opens the diagnostics, the rest of that
+// SELECT press is then ignored
+bool selectHeld = false;
+bool selectConsumed = false;
+Screen diagReturnScreen = SCREEN_ROUTES;
+
+// Station selection made while offline, see replayPending()
+NetRequest pendingSelect = {};
+bool selectPending = false;
+WifiLink shownLink = WIFI_LINK_UP;  // what the corner indicator shows
+
+unsigned long lastActivity = 0;
+unsigned long standbyIdleMs = STANDBY_INACTIVITY_MS;
+bool allPassed = false;
+unsigned long allPassedSince = 0;
+
+// Catalog caches live in the "transit" NVS namespace
+NvsKvStore nvsStore("transit");
+KvStore *kvStore = &nvsStore;
+CacheIndex catalogCache;
 
-unsigned long lastStatusFetch = 0;
-String lastStatus = "";
+void setup() {
+  Serial.begin(115200);
+  setenv("TZ", TIMEZONE, 1);  // for rendering status timestamps, no clock sync needed
+  tzset();
+  bool resumed = restoreFromStandby(lastStatus);
+  initDisplay();
 
-bool selectPressed = false;
-bool selectLongHandled = false;
-bool clearWarningShown = false;
-unsigned long selectPressStart = 0;
-unsigned long lastPopupUpdate = 0;
-const unsigned long POPUP_UPDATE_INTERVAL = 200;
-const unsigned long POPUP_START_DELAY = 1000;
+  // Show the kept status right away, the lists stay unloaded until needed
+  if (resumed && currentScreen == SCREEN_STATUS) {
+    displayStatus(lastStatus);
+    diagBootMark(DIAG_BOOT_FIRST_FRAME);
+  }
+
+  diagRegisterTask(xTaskGetCurrentTaskHandle(), "ui");
+  initNVS();
+  loadWatchlist(watchlist);
+  initButtons();
+  // Requests wait for the link in the network task, the cached routes are
+  // drawn while WiFi is still associating
+  wifiStart();
+  startNetworkTask();
+  startStatusStreamTask();
+
+  // A timer wake only refreshes the status, go back down soon if untouched
+  if (resumed && wokeByTimer()) {
+    standbyIdleMs = STANDBY_TIMER_AWAKE_MS;
+  }
+  lastActivity = millis();
+
+#ifdef PIPELINE_BENCH
+  pipelineBenchStart();
+#else
+  if (currentScreen != SCREEN_STATUS) {
+    currentScreen = SCREEN_ROUTES;
+    loadRoutes();
+  }
+#endif
+}
 
-// NVS globals
-nvs_handle_t nvsHandle = 0;
-esp_err_t nvsErr = ESP_OK;
+// Runs action from the UI loop after delayMs, replacing any pending one
+void deferUi(unsigned long delayMs, std::function<void()> action) {
+  deferredAction = action;
+  deferredAt = millis() + delayMs;
+}
 
-void initButtons() {
-  pinMode(BTN_NEXT, INPUT_PULLUP);
-  pinMode(BTN_SELECT, INPUT_PULLUP);
+void cancelDeferredUi() {
+  deferredAction = nullptr;
 }
 
-void startWiFi() {
-  WiFi.begin(ssid, password);
-  
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
+// Moves a page into its window, which then owns the page's strings. Indices
+// are list indices, so a fresher copy arriving while the user browses does
+// not move them back to 1/N.
+template <typename T>
+static void applyPage(ListWindow<T> &list, bool &loaded, int &index, const NetResult &result, ListPage<T> &page) {
+  list.merge(result.offset, result.total, page, index);
+  loaded = true;
+  if (index >= list.total) {
+    index = 0;  // the list shrank on the server
   }
-  
-  Serial.println("\nWi-Fi connected");
 }
 
-bool checkWiFi() {
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("Wi-Fi disconnected");
-    return false;
+// Requests the page after the window once index gets close to its end
+template <typename T>
+static uint32_t prefetchNext(const ListWindow<T> &list, int index, NetRequestType type, int routeId,
+                             const char *tripId = "") {
+  int next = list.end();
+  if (next >= list.total || index + LIST_PREFETCH_MARGIN < next) {
+    return 0;
   }
 
-  return true;
+  NetRequest request = {};
+  request.type = type;
+  request.routeId = routeId;
+  request.offset = next;
+  strlcpy(request.tripId, tripId, sizeof(request.tripId));
+  Serial.println("[LIST] Prefetching from " + String(next));
+  return postNetRequest(request);
 }
 
-void setup() {
-  Serial.begin(115200);
-  delay(5000);  //wait for serial to be ready
-  initDisplay();
-  initNVS();
-  initButtons();
-  startWiFi();
-  delay(1000);
-  loadRoutes();
+void prefetchAround() {
+  if (prefetchSeq != 0) return;
+
+  if (currentScreen == SCREEN_ROUTES && routesLoaded) {
+    prefetchSeq = prefetchNext(routes, currentRouteIndex, NET_LOAD_ROUTES, 0);
+  } else if (currentScreen == SCREEN_TRIPS && tripsLoaded) {
+    prefetchSeq = prefetchNext(trips, currentTripIndex, NET_LOAD_TRIPS, trips.owner);
+  } else if (currentScreen == SCREEN_STATIONS && stationsLoaded) {
+    prefetchSeq = prefetchNext(stations, currentStationIndex, NET_LOAD_STATIONS, 0, selectedTripId);
+  }
 }
 
-void loop() {
-  if (!checkWiFi()) {
-    delay(5000);
-    return;
+// Queues NET_WARM_* for the highlighted route or trip, then its neighbours
+// nearest first, so SELECT finds the next screen in the cache. Posted once
+// per resting place, the next button press cancels what has not run yet.
+static void postWarm(int index) {
+  NetRequest request = {};
+  if (currentScreen == SCREEN_ROUTES) {
+    request.type = NET_WARM_TRIPS;
+    request.routeId = routes[index].route_id;
+  } else {
+    request.type = NET_WARM_STATIONS;
+    strlcpy(request.tripId, trips[index].trip_id, sizeof(request.tripId));
   }
-  
-  unsigned long now = millis();
+  postNetRequest(request);
+}
 
-  // Handle SELECT button presses
-  bool selectDown = (digitalRead(BTN_SELECT) == LOW);
-  if (selectDown) {
-    if (!selectPressed) {
-      selectPressed = true;
-      selectPressStart = now;
-      selectLongHandled = false;
-      clearWarningShown = false;
-      lastPopupUpdate = 0;
+// The highlighted route or trip while it still needs warming, -1 otherwise
+static int warmTarget(int &total) {
+  if (warmPosted || uiAwaitingSeq != 0) return -1;
+
+  if (currentScreen == SCREEN_ROUTES && routesLoaded && routes.has(currentRouteIndex)) {
+    total = routes.size();
+    return currentRouteIndex;
+  }
+  if (currentScreen == SCREEN_TRIPS && tripsLoaded && trips.has(currentTripIndex)) {
+    total = trips.size();
+    return currentTripIndex;
+  }
+  return -1;
+}
+
+static bool warmable(int index) {
+  return currentScreen == SCREEN_ROUTES ? routes.has(index) : trips.has(index);
+}
+
+void warmAround(unsigned long now) {
+  int total = 0;
+  int current = warmTarget(total);
+  if (current < 0 || (long)(now - lastActivity) < WARM_IDLE_MS) return;
+  warmPosted = true;
+
+  postWarm(current);
+  for (int distance = 1; distance <= WARM_NEIGHBORS; distance++) {
+    int next = (current + distance) % total;
+    int previous = (current - distance + total) % total;
+    if (next != current && warmable(next)) postWarm(next);
+    if (previous != current && previous != next && warmable(previous)) postWarm(previous);
+  }
+}
+
+// Each stop's seq changes with its status, the count when the list did
+static bool batchChanged(const StatusBatch &batch) {
+  if (batch.count != lastBatch.count) return true;
+  for (uint8_t i = 0; i < batch.count; i++) {
+    if (batch.status[i].seq != lastBatch.status[i].seq || batch.status[i].version != lastBatch.status[i].version) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void handleNetResult(NetResult &result) {
+#ifdef PIPELINE_BENCH
+  pipelineBenchObserve(result);
+#endif
+
+  if (result.type == RESULT_STATUS) {
+    // Stream events have no request behind them
+    if (result.seq != 0) statusInFlight = false;
+
+    const CompactStatus &status = result.status;
+    nextStatusPoll = millis() + nextStatusPollDelay(result.httpCode, status, result.retryAfterMs);
+    if (status.version == 0) {
+      freeNetResult(result);
+      return;
+    }
+    diagBootMark(DIAG_BOOT_FIRST_STATUS);
+
+    if (status.state == TRAM_ALL_PASSED) {
+      if (!allPassed) allPassedSince = millis();
+      allPassed = true;
     } else {
-      unsigned long elapsed = now - selectPressStart;
-      
-      if (!clearWarningShown && elapsed >= CLEAR_NVS_PRESS_MS) {
-        clearWarningShown = true;
-        gfx->fillScreen(BLACK);
-        gfx->setTextSize(2);
-        gfx->setTextColor(YELLOW);
-        gfx->setCursor(6, 60);
-        gfx->println("Clearing cache...");
-        Serial.println("User requested NVS clear (10s hold)");
-        
-        clearNVS();
-        delay(1000);
-        
-        loadRoutes();
-        selectLongHandled = true;
-        lastButtonPress = now;
-      } else if (!selectLongHandled && elapsed >= LONG_PRESS_MS) {
-        selectLongHandled = true;
-        lastButtonPress = now;
-        if (currentScreen != SCREEN_ROUTES) {
-          currentScreen = SCREEN_ROUTES;
-          displayCurrentRoute();
-        }
-      } else if (elapsed >= POPUP_START_DELAY && !clearWarningShown && (now - lastPopupUpdate >= POPUP_UPDATE_INTERVAL)) {
-        lastPopupUpdate = now;
-        unsigned long remaining = CLEAR_NVS_PRESS_MS - elapsed;
-        drawClearPopup(remaining);
+      allPassed = false;
+    }
+
+    if (result.batch) {
+      // Rows would land on the wrong stops after an edit
+      if (currentScreen == SCREEN_STATUS && result.seq > staleStatusSeq && batchChanged(*result.batch)) {
+        lastBatch = *result.batch;
+        lastStatus = status;
+        Serial.println("[STATUS] Updated " + String(lastBatch.count) + " stops");
+        displayWatchlist(watchlist, lastBatch, watchCursor);
       }
+    } else if (currentScreen == SCREEN_STATUS && (lastStatus.version == 0 || status.seq != lastStatus.seq)) {
+      lastStatus = status;
+      Serial.println("[STATUS] Updated, seq " + String(status.seq));
+      displayStatus(status);
     }
-  } else if (selectPressed) {
-    if (!selectLongHandled && (now - lastButtonPress > DEBOUNCE_DELAY)) {
-      lastButtonPress = now;
-
-      if (currentScreen == SCREEN_ROUTES) {
-        if (routesLoaded && !routes.empty()) {
-          loadTripsForRoute(routes[currentRouteIndex].route_id);
-        } else {
-          loadRoutes();
-        }
-      } else if (currentScreen == SCREEN_TRIPS) {
-        if (tripsLoaded && !trips.empty()) {
-          loadStations();
-        } else if (routesLoaded && !routes.empty()) {
-          loadTripsForRoute(routes[currentRouteIndex].route_id);
-        }
-      } else if (currentScreen == SCREEN_STATIONS) {
-        if (stationsLoaded && !stations.empty()) {
-          selectStation();
-        }
-      } else if (currentScreen == SCREEN_STATUS) {
-        currentScreen = SCREEN_STATIONS;
-        displayCurrentStation();
-        lastStatus = "";
+    freeNetResult(result);
+    return;
+  }
+
+  // Navigation results are only applied while the user still waits for
+  // them, prefetched pages are merged quietly
+  bool awaited = result.seq == uiAwaitingSeq;
+  bool prefetched = result.seq != 0 && result.seq == prefetchSeq;
+  if (!awaited && !prefetched) {
+    freeNetResult(result);
+    return;
+  }
+
+  // The last result of a load, nothing more arrives for this seq
+  bool done = !result.fromCache;
+  if (prefetched && done) prefetchSeq = 0;
+  if (awaited) cancelDeferredUi();
+
+  switch (result.type) {
+    case RESULT_ROUTES:
+      applyPage(routes, routesLoaded, currentRouteIndex, result, *result.routes);
+      if (awaited) {
+        if (done) Serial.println("Routes refreshed from API");
+        displayCurrentRoute();
+        diagBootMark(DIAG_BOOT_FIRST_FRAME);
+      }
+      break;
+
+    case RESULT_TRIPS:
+      if (trips.owner != result.routeId) {
+        if (!awaited) break;  // prefetch for a route the user has left
+        trips.clear();
+        trips.owner = result.routeId;
+        stations.clear();
+        stationsLoaded = false;
+        currentStationIndex = 0;
+      }
+      applyPage(trips, tripsLoaded, currentTripIndex, result, *result.trips);
+      if (awaited) displayCurrentTrip();
+      break;
+
+    case RESULT_STATIONS:
+      if (strcmp(result.tripId, selectedTripId) != 0) break;  // prefetch for a trip the user has left
+      applyPage(stations, stationsLoaded, currentStationIndex, result, *result.stations);
+      if (awaited) displayCurrentStation();
+      break;
+
+    case RESULT_STATION_SELECTED:
+      uiAwaitingSeq = 0;
+      if (result.httpCode == HTTP_CODE_OK) {
+        showMessage("Selected!\n" + String(result.text), GREEN, 2, 40);
+        Serial.println("Station selected: " + String(result.text));
+        deferUi(MESSAGE_HOLD_MS, getStatus);
+      } else {
+        showMessage(result.httpCode < 0 ? String("Connection failed") : "Error: " + String(result.httpCode), RED);
+        deferUi(MESSAGE_HOLD_MS, displayCurrentStation);
+      }
+      break;
+
+    case RESULT_ERROR:
+      if (awaited) {
+        uiAwaitingSeq = 0;
+        showMessage(String(result.text), RED);
+      } else {
+        Serial.println("[LIST] Prefetch failed: " + String(result.text));
       }
+      break;
+
+    default:
+      break;
+  }
+
+  if (awaited && done) {
+    uiAwaitingSeq = 0;
+  }
+  freeNetResult(result);
+  prefetchAround();
+}
+
+void showStatusScreen() {
+  if (watchlist.empty()) {
+    displayStatus(lastStatus);
+  } else {
+    displayWatchlist(watchlist, lastBatch, watchCursor);
+  }
+}
+
+// The network task keeps the NVS copy
+void saveWatches() {
+  NetRequest request = {};
+  request.type = NET_SAVE_WATCHES;
+  request.watches = new Watchlist(watchlist);
+  postNetRequest(request);
+}
+
+void redrawCurrentScreen() {
+  if (currentScreen == SCREEN_ROUTES) {
+    displayCurrentRoute();
+  } else if (currentScreen == SCREEN_TRIPS) {
+    displayCurrentTrip();
+  } else if (currentScreen == SCREEN_STATIONS) {
+    displayCurrentStation();
+  } else if (currentScreen == SCREEN_STATUS) {
+    showStatusScreen();
+  } else if (currentScreen == SCREEN_DIAG) {
+    displayDiagnostics();
+  }
+}
+
+void leaveStatus() {
+  currentScreen = SCREEN_STATIONS;
+  lastStatus = {};
+  lastBatch = {};
+  watchCursor = -1;
+  allPassed = false;
+
+  // After a wake from standby only the indices are known
+  if (stationsLoaded) {
+    displayCurrentStation();
+  } else {
+    loadStations();
+  }
+}
+
+void openDiagnostics() {
+  uiAwaitingSeq = 0;
+  cancelDeferredUi();
+  diagReturnScreen = currentScreen;
+  displayDiagnostics();
+}
+
+// Back to the screen the diagnostics were opened from
+void closeDiagnostics() {
+  if (diagReturnScreen == SCREEN_STATUS) {
+    getStatus();
+    showStatusScreen();
+    return;
+  }
+  currentScreen = diagReturnScreen;
+  redrawCurrentScreen();
+}
+
+void removeWatch(int index) {
+  Serial.println("[WATCH] Stopped watching " + String(watchlist[index].stopName));
+  watchlist.remove(index);
+  saveWatches();
+
+  // Keep the remaining rows until the next poll answers for the new list
+  if (index < lastBatch.count) {
+    for (int i = index; i + 1 < lastBatch.count; i++) {
+      lastBatch.status[i] = lastBatch.status[i + 1];
+    }
+    lastBatch.count--;
+  }
+  staleStatusSeq = statusPollSeq;
+  nextStatusPoll = millis();
+  watchCursor = -1;
+
+  if (watchlist.empty()) {
+    leaveStatus();
+  } else {
+    showStatusScreen();
+  }
+}
+
+void onSelectClick() {
+  if (currentScreen == SCREEN_ROUTES) {
+    if (routesLoaded && routes.has(currentRouteIndex)) {
+      loadTripsForRoute(routes[currentRouteIndex].route_id);
+    } else {
+      loadRoutes();
+    }
+  } else if (currentScreen == SCREEN_TRIPS) {
+    if (tripsLoaded && trips.has(currentTripIndex)) {
+      // Kept for the watch a station pick adds, the trip window may move on
+      strlcpy(selectedTripId, trips[currentTripIndex].trip_id, sizeof(selectedTripId));
+      strlcpy(selectedRouteName, routes.has(currentRouteIndex) ? routes[currentRouteIndex].route_short_name : "",
+              sizeof(selectedRouteName));
+
+      // The window may still hold another trip's stations
+      stations.clear();
+      stationsLoaded = false;
+      currentStationIndex = 0;
+      loadStations();
+    } else if (routesLoaded && routes.has(currentRouteIndex)) {
+      loadTripsForRoute(routes[currentRouteIndex].route_id);
     }
-    
-    // Clear popup if it was shown but user released early
-    if (clearWarningShown && !selectLongHandled) {
-      clearWarningShown = false;
-      selectLongHandled = false;
-      if (currentScreen == SCREEN_ROUTES) {
+  } else if (currentScreen == SCREEN_STATIONS) {
+    if (stationsLoaded && stations.has(currentStationIndex)) {
+      selectStation();
+    }
+  } else if (currentScreen == SCREEN_STATUS) {
+    if (watchCursor >= 0) {
+      removeWatch(watchCursor);
+    } else {
+      leaveStatus();
+    }
+  } else if (currentScreen == SCREEN_DIAG) {
+    closeDiagnostics();
+  }
+}
+
+void onNext() {
+  if (currentScreen == SCREEN_ROUTES) {
+    if (routesLoaded && !routes.empty()) {
+      currentRouteIndex = (currentRouteIndex + 1) % routes.size();
+      if (routes.has(currentRouteIndex)) {
         displayCurrentRoute();
-      } else if (currentScreen == SCREEN_TRIPS) {
+      } else {
+        loadRoutes();
+      }
+      Serial.println("Next route: " + String(currentRouteIndex));
+    } else {
+      loadRoutes();
+    }
+  } else if (currentScreen == SCREEN_TRIPS) {
+    if (tripsLoaded && !trips.empty()) {
+      currentTripIndex = (currentTripIndex + 1) % trips.size();
+      if (trips.has(currentTripIndex)) {
         displayCurrentTrip();
-      } else if (currentScreen == SCREEN_STATIONS) {
-        displayCurrentStation();
-      } else if (currentScreen == SCREEN_STATUS) {
-        // Will be redrawn by polling
+      } else {
+        loadTripsForRoute(trips.owner);
       }
+      Serial.println("Next trip: " + String(currentTripIndex));
+    } else if (routesLoaded && routes.has(currentRouteIndex)) {
+      loadTripsForRoute(routes[currentRouteIndex].route_id);
     }
-    
-    selectPressed = false;
-  }
-  
-  // Handle NEXT button (navigation)
-  if (now - lastButtonPress > DEBOUNCE_DELAY) {
-    if (digitalRead(BTN_NEXT) == LOW) {
-      lastButtonPress = now;
-
-      if (currentScreen == SCREEN_ROUTES) {
-        if (routesLoaded && !routes.empty()) {
-          currentRouteIndex = (currentRouteIndex + 1) % routes.size();
-          displayCurrentRoute();
-          Serial.println("Next route: " + String(currentRouteIndex));
-        } else {
-          loadRoutes();
-        }
-      } else if (currentScreen == SCREEN_TRIPS) {
-        if (tripsLoaded && !trips.empty()) {
-          currentTripIndex = (currentTripIndex + 1) % trips.size();
-          displayCurrentTrip();
-          Serial.println("Next trip: " + String(currentTripIndex));
-        } else if (routesLoaded && !routes.empty()) {
-          loadTripsForRoute(routes[currentRouteIndex].route_id);
-        }
-      } else if (currentScreen == SCREEN_STATIONS) {
-        if (stationsLoaded && !stations.empty()) {
-          currentStationIndex = (currentStationIndex + 1) % stations.size();
-          displayCurrentStation();
-          Serial.println("Next station: " + String(currentStationIndex + 1));
-        } else {
-          loadStations();
-        }
-      } else if (currentScreen == SCREEN_STATUS) {
-        currentScreen = SCREEN_STATIONS;
+  } else if (currentScreen == SCREEN_STATIONS) {
+    if (stationsLoaded && !stations.empty()) {
+      currentStationIndex = (currentStationIndex + 1) % stations.size();
+      if (stations.has(currentStationIndex)) {
         displayCurrentStation();
-        lastStatus = "";
+      } else {
+        loadStations();
       }
+      Serial.println("Next station: " + String(currentStationIndex + 1));
+    } else {
+      loadStations();
+    }
+  } else if (currentScreen == SCREEN_STATUS) {
+    // Steps through the watched stops, past the last one back to the stations
+    if (watchCursor + 1 < watchlist.count()) {
+      watchCursor++;
+      showStatusScreen();
+    } else {
+      leaveStatus();
+    }
+  } else if (currentScreen == SCREEN_DIAG) {
+    displayDiagnostics();
+  }
 
-      delay(200);
+  prefetchAround();
+}
+
+void handleButtonEvent(const ButtonEvent &event) {
+  lastActivity = millis();
+  standbyIdleMs = STANDBY_INACTIVITY_MS;
+  if (warmPosted) {
+    warmPosted = false;
+    cancelWarming();
+  }
+
+  if (event.button == BUTTON_NEXT) {
+    if (event.gesture == GESTURE_PRESS && selectHeld && !selectConsumed) {
+      selectConsumed = true;
+      clearPopupShown = false;
+      openDiagnostics();
+      return;
     }
+    // NEXT acts on press and keeps stepping while held
+    if (event.gesture == GESTURE_PRESS || event.gesture == GESTURE_REPEAT) {
+      cancelDeferredUi();
+      onNext();
+    }
+    return;
   }
 
-  // Poll status screen updates
-  if (currentScreen == SCREEN_STATUS) {
-    if (now - lastStatusFetch >= STATUS_POLL_INTERVAL) {
-      lastStatusFetch = now;
-
-      WiFiClientSecure *client = new WiFiClientSecure;
-      client->setInsecure();
-      HTTPClient http;
-
-      String url = String(serverUrl) + "/api/status";
-
-      if (http.begin(*client, url)) {
-        int httpCode = http.GET();
-
-        if (httpCode == HTTP_CODE_OK) {
-          String status = http.getString();
-          
-          if (status != lastStatus) {
-            lastStatus = status;
-            Serial.println("[STATUS] Updated: " + status);
-
-            gfx->fillScreen(BLACK);
-            gfx->setTextSize(2);
-            gfx->setTextColor(GREEN);
-            gfx->setCursor(10, 10);
-            gfx->println("Tram Status:");
-
-            gfx->setTextSize(3);
-            gfx->setTextColor(YELLOW);
-            gfx->setCursor(10, 50);
-            gfx->println(status);
-
-            gfx->setTextSize(1);
-            gfx->setTextColor(WHITE);
-            gfx->setCursor(10, 145);
-            gfx->println("BTN1: Back  BTN2: Refresh");
-          }
-        }
+  if (event.gesture == GESTURE_PRESS) {
+    selectHeld = true;
+    selectConsumed = false;
+  } else if (event.gesture == GESTURE_CLICK || event.gesture == GESTURE_RELEASE) {
+    selectHeld = false;
+  }
+  if (selectConsumed) return;
+
+  switch (event.gesture) {
+    case GESTURE_PRESS:
+      clearPopupShown = false;
+      clearDone = false;
+      break;
+
+    case GESTURE_CLICK:
+      cancelDeferredUi();
+      onSelectClick();
+      break;
+
+    case GESTURE_LONG_PRESS:
+      uiAwaitingSeq = 0;
+      cancelDeferredUi();
+      if (!routesLoaded) {
+        currentScreen = SCREEN_ROUTES;
+        loadRoutes();
+      } else if (currentScreen != SCREEN_ROUTES) {
+        currentScreen = SCREEN_ROUTES;
+        displayCurrentRoute();
       }
-
-      http.end();
-      delete client;
+      break;
+
+    case GESTURE_HOLD_TICK:
+      clearPopupShown = true;
+      drawClearPopup(CLEAR_NVS_PRESS_MS - event.heldMs);
+      break;
+
+    case GESTURE_CLEAR_HOLD: {
+      clearDone = true;
+      gfx->fillScreen(BLACK);
+      gfx->setTextSize(2);
+      gfx->setTextColor(YELLOW);
+      gfx->setCursor(6, 60);
+      gfx->println("Clearing cache...");
+      gfx->flush();
+      Serial.println("User requested NVS clear (10s hold)");
+
+      resetCatalog();
+      NetRequest request = {};
+      request.type = NET_CLEAR_CACHE;
+      postNetRequest(request);
+
+      loadRoutes();
+      break;
     }
+
+    case GESTURE_RELEASE:
+      // Clear popup if it was shown but user released early
+      if (clearPopupShown && !clearDone) {
+        redrawCurrentScreen();
+      }
+      clearPopupShown = false;
+      break;
+
+    default:
+      break;
   }
-  
-  delay(50);
 }
 
-void getStatus() {
-  if (!checkWiFi()) {
-    showMessage("WiFi disconnected", RED);
-    return;
+// How long until the device should drop into standby
+unsigned long msUntilStandby(unsigned long now) {
+  long due = (long)(lastActivity + standbyIdleMs - now);
+
+  if (currentScreen == SCREEN_STATUS && allPassed) {
+    due = min(due, (long)(allPassedSince + STANDBY_PASSED_DELAY_MS - now));
   }
 
-  currentScreen = SCREEN_STATUS;
-  lastStatusFetch = 0;  // Force immediate poll on first call
-  lastStatus = "";
+  return due > 0 ? due : 0;
 }
 
-void selectStation() {
-  if (!stationsLoaded || stations.empty()) return;
+// How long the UI loop may sleep before a timer of its own is due
+unsigned long msUntilNextWork(unsigned long now) {
+  unsigned long wait = ULONG_MAX;
 
-  Station &station = stations[currentStationIndex];
+  if (deferredAction) {
+    long due = (long)(deferredAt - now);
+    wait = due > 0 ? due : 0;
+  }
 
-  showMessage("Selecting...\nStop " + String(station.sequence), YELLOW, 2, 40);
+  if (currentScreen == SCREEN_STATUS && !statusInFlight && !statusStreamLive()) {
+    long due = (long)(nextStatusPoll - now);
+    wait = min(wait, (unsigned long)(due > 0 ? due : 0));
+  }
 
-  WiFiClientSecure *client = new WiFiClientSecure;
-  client->setInsecure();
-  HTTPClient http;
+  if (uiAwaitingSeq == 0) {
+    wait = min(wait, msUntilStandby(now));
+  }
 
-  String url = String(serverUrl) + "/api/user-location";
-  url += "?lat=" + String(station.lat, 6);
-  url += "&lon=" + String(station.lon, 6);
-  url += "&name=" + station.name;
+  wait = min(wait, diagMsUntilSummary(now));
+  wait = min(wait, wifiMsUntilTick(now));
+  int warmTotal;
+  if (warmTarget(warmTotal) >= 0) {
+    long due = (long)(lastActivity + WARM_IDLE_MS - now);
+    wait = min(wait, (unsigned long)(due > 0 ? due : 0));
+  }
+#ifdef PIPELINE_BENCH
+  wait = min(wait, pipelineBenchMsUntilStep(now));
+#endif
 
-  url.replace(" ", "%20");
+  return wait;
+}
 
-  if (!http.begin(*client, url)) {
-    showMessage("Connection failed", RED);
-    delete client;
-    delay(2000);
-    displayCurrentStation();
-    return;
+// Actions taken while offline, run once the link is back. The user has
+// moved on by then, so their results are not awaited.
+void replayPending() {
+  if (selectPending) {
+    selectPending = false;
+    Serial.println("[WIFI] Sending the selection made offline: " + String(pendingSelect.name));
+    postNetRequest(pendingSelect);
   }
+}
 
-  int httpCode = http.POST("");
+void loop() {
+  if (wifiTick(millis())) {
+    replayPending();
+  }
+  if (wifiLink != shownLink) {
+    shownLink = wifiLink;
+    showLinkState();
+  }
 
-  if (httpCode == HTTP_CODE_OK) {
-    showMessage("Selected!\n" + station.name, GREEN, 2, 40);
-    Serial.println("Station selected: " + station.name);
-    delay(2000);
+  ButtonEvent event;
+  while (receiveButtonEvent(event)) {
+    handleButtonEvent(event);
+  }
 
-    getStatus();
-  } else {
-    showMessage("Error: " + String(httpCode), RED);
-    delay(2000);
-    displayCurrentStation();
+  NetResult result;
+  while (receiveNetResult(result, 0)) {
+    handleNetResult(result);
+  }
+
+  unsigned long now = millis();
+
+#ifdef PIPELINE_BENCH
+  pipelineBenchStep(now);
+  lastActivity = now;  // a benchmark run is not idle
+#endif
+
+  if (diagMsUntilSummary(now) == 0) {
+    diagTick(now);
+    if (currentScreen == SCREEN_DIAG) displayDiagnostics();
+  }
+
+  // Not while a navigation request (or a cache clear before it) is running
+  if (uiAwaitingSeq == 0 && msUntilStandby(now) == 0) {
+    enterStandby(lastStatus);
+  }
+
+  if (deferredAction && (long)(now - deferredAt) >= 0) {
+    std::function<void()> action = deferredAction;
+    deferredAction = nullptr;
+    action();
+  }
+
+  warmAround(now);
+
+  // Status updates are pushed over the stream, polling covers when it is down.
+  // The stream only carries the backend's own stop, a watchlist always polls.
+  setStatusStreamWanted(currentScreen == SCREEN_STATUS && watchlist.empty());
+
+  if (currentScreen == SCREEN_STATUS && !statusInFlight && !statusStreamLive()) {
+    if ((long)(now - nextStatusPoll) >= 0) {
+      // Replaced by the scheduler when the result arrives
+      nextStatusPoll = now + STATUS_POLL_FAST_MS;
+
+      NetRequest request = {};
+      request.type = NET_FETCH_STATUS;
+      request.watches = watchlist.empty() ? nullptr : new Watchlist(watchlist);
+      statusPollSeq = postNetRequest(request);
+      statusInFlight = statusPollSeq != 0;
+    }
+  }
+
+  // Sleep until a button event, a network result or our next timer
+  waitForUi(msUntilNextWork(millis()));
+}
+
+void getStatus() {
+  currentScreen = SCREEN_STATUS;
+  nextStatusPoll = millis();  // Force immediate poll on first call
+  resetStatusPoll();
+  lastStatus = {};
+  lastBatch = {};
+  watchCursor = -1;
+  staleStatusSeq = statusPollSeq;
+  allPassed = false;
+}
+
+void selectStation() {
+  if (!stationsLoaded || !stations.has(currentStationIndex)) return;
+
+  Station &station = stations[currentStationIndex];
+
+  showMessage("Selecting...\nStop " + String(station.sequence), YELLOW, 2, 40);
+
+  // Watched from now on, first in the list
+  Watch watch = {};
+  strlcpy(watch.tripId, selectedTripId, sizeof(watch.tripId));
+  strlcpy(watch.routeName, selectedRouteName, sizeof(watch.routeName));
+  strlcpy(watch.stopName, station.name, sizeof(watch.stopName));
+  watch.lat = station.lat;
+  watch.lon = station.lon;
+  if (watch.tripId[0] != '\0') {
+    watchlist.add(watch);
+    saveWatches();
   }
 
-  http.end();
-  delete client;
-}
\ No newline at end of file
+  NetRequest request = {};
+  request.type = NET_SELECT_STATION;
+  request.lat = station.lat;
+  request.lon = station.lon;
+  strlcpy(request.name, station.name, sizeof(request.name));
+  strlcpy(request.tripId, selectedTripId, sizeof(request.tripId));
+
+  // The watchlist works without the backend, it is told once WiFi is back
+  if (wifiLink != WIFI_LINK_UP) {
+    pendingSelect = request;
+    selectPending = true;
+    showMessage("Offline\nSelected when\nWiFi is back", ORANGE, 2, 40);
+    deferUi(MESSAGE_HOLD_MS, []() {
+      getStatus();
+      displayWatchlist(watchlist, lastBatch, watchCursor);
+    });
+    return;
+  }
+  uiAwaitingSeq = postNetRequest(request);
+}
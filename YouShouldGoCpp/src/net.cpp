@@ -0,0 +1,334 @@
+#include "net.h"
+#include "app.h"
+#include "catalog.h"
+#include "fastwifi.h"
+
+// One TLS connection to serverUrl is kept open between requests. HTTPClient
+// reuses it as long as the socket is still connected, so the handshake is only
+// paid after the server (or WiFi) drops the link. An http:// serverUrl (the
+// local replay backend) uses a plain socket instead.
+
+#define NET_TIMEOUT_MS 8000
+
+HTTPClient http;
+
+static WiFiClientSecure secureClient;
+static WiFiClient plainClient;
+static WiFiClient *client = &secureClient;
+static bool clientConfigured = false;
+
+static String serverHost = "";
+static uint16_t serverPort = 443;
+static IPAddress serverIP;
+static bool serverIPCached = false;
+
+static String currentUrl = "";
+
+static std::vector<std::pair<String, String>> requestHeaders;
+
+static volatile uint32_t bodyBytes = 0;
+
+static char deviceIdText[20] = "";
+
+static const char *collectedHeaders[] = {"Transfer-Encoding", "ETag", "Retry-After", "X-Total-Count"};
+
+// Response body reader on top of the raw socket. HTTPClient only decodes
+// chunked transfer encoding inside getString()/writeToStream(), so streaming
+// parsers need this to read the body without buffering it first. It also
+// knows where the body ends, which keeps the keep-alive socket in sync.
+class BodyStream : public Stream {
+public:
+  void begin(WiFiClient *raw, bool chunked, int contentLength) {
+    _raw = raw;
+    _chunked = chunked;
+    _remaining = chunked ? 0 : contentLength;
+    _done = !chunked && contentLength == 0;
+    _peeked = -1;
+  }
+
+  int available() override {
+    if (_peeked >= 0) return 1;
+    if (_done || !_raw) return 0;
+    return _raw->available();
+  }
+
+  int read() override {
+    if (_peeked >= 0) {
+      int c = _peeked;
+      _peeked = -1;
+      return c;
+    }
+    return nextByte();
+  }
+
+  int peek() override {
+    if (_peeked < 0) _peeked = nextByte();
+    return _peeked;
+  }
+
+  size_t write(uint8_t) override { return 0; }
+
+  // Reads and discards whatever is left of the body
+  void drain() {
+    _peeked = -1;
+    while (nextByte() >= 0) {
+    }
+  }
+
+private:
+  int rawByte() {
+    char c;
+    return _raw->readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+  }
+
+  bool readChunkHeader() {
+    String line = _raw->readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0) {
+      // CRLF that terminates the previous chunk's data
+      line = _raw->readStringUntil('\n');
+      line.trim();
+    }
+    _remaining = strtol(line.c_str(), NULL, 16);
+    if (_remaining <= 0) {
+      _raw->readStringUntil('\n');  // final CRLF after the last chunk
+      _done = true;
+      return false;
+    }
+    return true;
+  }
+
+  int nextByte() {
+    if (_done || !_raw) return -1;
+
+    if (_chunked && _remaining == 0 && !readChunkHeader()) {
+      return -1;
+    }
+
+    int c = rawByte();
+    if (c < 0) {
+      _done = true;
+      return -1;
+    }
+    bodyBytes++;
+
+    // A negative content length means "read until the server closes"
+    if (_remaining > 0 && --_remaining == 0 && !_chunked) {
+      _done = true;
+    }
+    return c;
+  }
+
+  WiFiClient *_raw = nullptr;
+  bool _chunked = false;
+  long _remaining = 0;
+  bool _done = true;
+  int _peeked = -1;
+};
+
+static BodyStream bodyStream;
+static bool bodyStreamActive = false;
+
+static void parseServerUrl() {
+  if (serverHost.length() > 0) return;
+
+  String url = String(serverUrl);
+  int start = url.indexOf("://");
+  start = (start >= 0) ? start + 3 : 0;
+
+  int end = url.indexOf('/', start);
+  if (end < 0) end = url.length();
+
+  String hostPort = url.substring(start, end);
+  int colon = hostPort.indexOf(':');
+  if (colon >= 0) {
+    serverHost = hostPort.substring(0, colon);
+    serverPort = hostPort.substring(colon + 1).toInt();
+  } else {
+    serverHost = hostPort;
+    serverPort = url.startsWith("http://") ? 80 : 443;
+  }
+
+  if (url.startsWith("http://")) {
+    client = &plainClient;
+  }
+}
+
+static bool resolveServer() {
+  if (serverIPCached) return true;
+
+  if (!WiFi.hostByName(serverHost.c_str(), serverIP)) {
+    Serial.println("[NET] ERROR: DNS lookup failed for " + serverHost);
+    return false;
+  }
+
+  serverIPCached = true;
+  Serial.println("[NET] Resolved " + serverHost + " -> " + serverIP.toString());
+  return true;
+}
+
+static bool connectClient() {
+  if (client == &plainClient) {
+    return plainClient.connect(serverIP, serverPort);
+  }
+  // Connect by cached IP but keep the hostname for SNI
+  return secureClient.connect(serverIP, serverPort, serverHost.c_str(), NULL, NULL, NULL);
+}
+
+static bool ensureConnected() {
+  if (client->connected()) return true;
+
+  const char *kind = client == &plainClient ? "TCP" : "TLS";
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (!resolveServer()) return false;
+
+    unsigned long start = millis();
+    if (connectClient()) {
+      Serial.println("[NET] " + String(kind) + " connected in " + String(millis() - start) + " ms");
+      return true;
+    }
+
+    // The cached address may be stale (hosting moved), retry with a fresh lookup
+    Serial.println("[NET] " + String(kind) + " connect failed, dropping DNS cache");
+    serverIPCached = false;
+  }
+
+  return false;
+}
+
+String urlEncode(const char *value) {
+  static const char hex[] = "0123456789ABCDEF";
+  String out;
+  for (const char *p = value; *p; p++) {
+    uint8_t c = *p;
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      out += (char)c;
+    } else {
+      out += '%';
+      out += hex[c >> 4];
+      out += hex[c & 15];
+    }
+  }
+  return out;
+}
+
+bool netBegin(const String &path) {
+  if (!clientConfigured) {
+    secureClient.setInsecure();
+    http.setReuse(true);
+    http.setTimeout(NET_TIMEOUT_MS);
+    clientConfigured = true;
+  }
+
+  parseServerUrl();
+
+  // Right after boot WiFi may still be associating
+  if (!wifiWaitConnected(NET_WIFI_WAIT_MS)) {
+    Serial.println("[NET] WiFi not connected");
+    return false;
+  }
+
+  if (!ensureConnected()) {
+    return false;
+  }
+
+  currentUrl = String(serverUrl) + path;
+  requestHeaders.clear();
+  if (!http.begin(*client, currentUrl)) {
+    return false;
+  }
+
+  // Must be set on every request, HTTPClient appends values across responses
+  http.collectHeaders(collectedHeaders, sizeof(collectedHeaders) / sizeof(collectedHeaders[0]));
+  netSetHeader("X-Device-Id", deviceId());
+  return true;
+}
+
+// The factory MAC from eFuse, the same across reflashes and NVS erases.
+// Both network tasks may format it first, they write the same bytes.
+const char *deviceId() {
+  if (deviceIdText[0] == '\0') {
+    snprintf(deviceIdText, sizeof(deviceIdText), "ysg-%012llx", (unsigned long long)ESP.getEfuseMac());
+  }
+  return deviceIdText;
+}
+
+// Adds a request header that survives the reconnect in sendWithRetry()
+void netSetHeader(const String &name, const String &value) {
+  requestHeaders.push_back(std::make_pair(name, value));
+  http.addHeader(name, value);
+}
+
+// Retries once on a transport error, which is what a keep-alive socket the
+// server already closed looks like from this side.
+static int sendWithRetry(const char *method, const String &body) {
+  int httpCode = http.sendRequest(method, body);
+  if (httpCode >= 0) return httpCode;
+
+  Serial.println("[NET] " + String(method) + " failed (" + HTTPClient::errorToString(httpCode) + "), reconnecting...");
+  http.end();
+  client->stop();
+
+  if (!ensureConnected() || !http.begin(*client, currentUrl)) {
+    return httpCode;
+  }
+  http.collectHeaders(collectedHeaders, sizeof(collectedHeaders) / sizeof(collectedHeaders[0]));
+  for (const auto &h : requestHeaders) {
+    http.addHeader(h.first, h.second);
+  }
+
+  return http.sendRequest(method, body);
+}
+
+int netGet() {
+  return sendWithRetry("GET", "");
+}
+
+int netPost(const String &body) {
+  return sendWithRetry("POST", body);
+}
+
+Stream &netStream() {
+  bool chunked = http.header("Transfer-Encoding").indexOf("chunked") >= 0;
+  bodyStream.begin(http.getStreamPtr(), chunked, http.getSize());
+  bodyStreamActive = true;
+  return bodyStream;
+}
+
+size_t netReadBody(uint8_t *buf, size_t max) {
+  Stream &stream = netStream();
+  size_t len = 0;
+  while (len < max) {
+    int c = stream.read();
+    if (c < 0) break;
+    buf[len++] = c;
+  }
+  return len;
+}
+
+DeserializationError netParseArray(JsonDocument &filter, std::function<void(JsonObject)> onElement) {
+  return parseJsonArray(netStream(), filter, onElement);
+}
+
+void netEnd() {
+  // Consume the rest of a streamed body so the next request on this socket
+  // does not start reading in the middle of it
+  if (bodyStreamActive) {
+    bodyStream.drain();
+    bodyStreamActive = false;
+  }
+
+  // With reuse enabled this keeps the socket open for the next request
+  http.end();
+}
+
+void netReset() {
+  http.end();
+  client->stop();
+  serverIPCached = false;
+}
+
+// Response body bytes read through netStream() since boot, for benchmarks
+uint32_t netBodyBytes() {
+  return bodyBytes;
+}
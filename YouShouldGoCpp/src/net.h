@@ -0,0 +1,25 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include <functional>
+// net.h declares the shared keep-alive HTTP(S) session used for every call to serverUrl
+
+// Shared request object, valid between netBegin() and netEnd()
+extern HTTPClient http;
+
+bool netBegin(const String &path);
+// Percent-encodes value for a query string, ids and names may hold '#', '&' or ','
+String urlEncode(const char *value);
+void netSetHeader(const String &name, const String &value);
+int netGet();
+int netPost(const String &body);
+Stream &netStream();
+// Reads the body into buf until it ends or max bytes, returns the length.
+// Unlike readBytes() it does not wait out the stream timeout on a short body.
+size_t netReadBody(uint8_t *buf, size_t max);
+DeserializationError netParseArray(JsonDocument &filter, std::function<void(JsonObject)> onElement);
+void netEnd();
+void netReset();
+uint32_t netBodyBytes();
+// Sent as X-Device-Id, the backend keeps this board's selection under it
+const char *deviceId();
@@ -0,0 +1,222 @@
+#include "pipelinebench.h"
+
+#ifdef PIPELINE_BENCH
+#include "net.h"
+#include "utils.h"
+#include <limits.h>
+
+enum BenchPhase {
+  BENCH_WAIT,       // between runs
+  BENCH_ROUTES,
+  BENCH_TRIPS,
+  BENCH_STATIONS,
+  BENCH_SELECT,
+  BENCH_STATUS,
+  BENCH_FINISHED
+};
+
+static const char *phaseNames[] = {"wait", "routes", "trips", "stations", "select", "status", "finished"};
+
+// Times are ms after the run started, except the per-phase ones
+struct BenchRun {
+  unsigned long start;
+  unsigned long firstRoute;   // first route on screen, from the cache or the server
+  bool firstRouteCached;
+  unsigned long routes;       // fresh routes page on screen
+  unsigned long trips;        // phase durations from here on
+  unsigned long stations;
+  unsigned long select;
+  unsigned long status;       // getStatus() to the first status drawn
+  uint32_t bytesAtStart;
+};
+
+static BenchPhase phase = BENCH_FINISHED;
+static int run = 0;
+static BenchRun current;
+static unsigned long phaseStart = 0;
+static unsigned long nextRunAt = 0;
+
+// Set by pipelineBenchObserve() before the result is handled, timed by
+// pipelineBenchStep() after it has been drawn
+static bool firstRouteSeen = false;
+static bool firstRoutePending = false;
+static bool phaseDone = false;
+static bool phaseFailed = false;
+
+static void enter(BenchPhase next) {
+  phase = next;
+  phaseStart = millis();
+  phaseDone = false;
+  phaseFailed = false;
+}
+
+static void startRun() {
+  current = {};
+  current.start = millis();
+  current.bytesAtStart = netBodyBytes();
+  firstRouteSeen = false;
+  firstRoutePending = false;
+
+  // Every run starts like a boot, the cold one also without NVS caches
+  resetCatalog();
+  if (run == 0) {
+    NetRequest request = {};
+    request.type = NET_CLEAR_CACHE;
+    postNetRequest(request);
+  }
+  currentScreen = SCREEN_ROUTES;
+
+  enter(BENCH_ROUTES);
+  loadRoutes();
+}
+
+static void finishRun(bool ok, unsigned long now) {
+  const char *kind = run == 0 ? "cold" : "warm";
+  uint32_t bytes = netBodyBytes() - current.bytesAtStart;
+
+  if (ok) {
+    Serial.printf("[BENCH] Run %d %s: first route %lu ms (%s), routes %lu ms, trips +%lu, stations +%lu, "
+                  "select +%lu, status %lu ms, %lu bytes\n",
+                  run, kind, current.firstRoute, current.firstRouteCached ? "cache" : "server", current.routes,
+                  current.trips, current.stations, current.select, current.status, (unsigned long)bytes);
+  } else {
+    Serial.printf("[BENCH] Run %d %s: failed in %s after %lu ms, %lu bytes\n",
+                  run, kind, phaseNames[phase], now - current.start, (unsigned long)bytes);
+  }
+
+  run++;
+  if (run > PIPELINE_BENCH_RUNS) {
+    Serial.println("[BENCH] Done");
+    phase = BENCH_FINISHED;
+    return;
+  }
+  phase = BENCH_WAIT;
+  nextRunAt = now + PIPELINE_BENCH_PAUSE_MS;
+}
+
+// Called from setup() in place of the first loadRoutes()
+void pipelineBenchStart() {
+  Serial.println("[BENCH] Pipeline benchmark against " + String(serverUrl) + ", " +
+                 String(PIPELINE_BENCH_RUNS) + " warm runs after a cold one");
+  run = 0;
+  startRun();
+}
+
+// Called by the UI loop for every result before handling it
+void pipelineBenchObserve(const NetResult &result) {
+  bool awaited = result.seq != 0 && result.seq == uiAwaitingSeq;
+
+  if (awaited && result.type == RESULT_ERROR) {
+    phaseFailed = true;
+    return;
+  }
+
+  switch (phase) {
+    case BENCH_ROUTES:
+      if (awaited && result.type == RESULT_ROUTES) {
+        if (!firstRouteSeen) {
+          firstRouteSeen = true;
+          firstRoutePending = true;
+          current.firstRouteCached = result.fromCache;
+        }
+        if (!result.fromCache) phaseDone = true;
+      }
+      break;
+
+    case BENCH_TRIPS:
+      if (awaited && result.type == RESULT_TRIPS && !result.fromCache) phaseDone = true;
+      break;
+
+    case BENCH_STATIONS:
+      if (awaited && result.type == RESULT_STATIONS && !result.fromCache) phaseDone = true;
+      break;
+
+    case BENCH_SELECT:
+      if (awaited && result.type == RESULT_STATION_SELECTED) {
+        phaseDone = true;
+        phaseFailed = result.httpCode != HTTP_CODE_OK;
+      }
+      break;
+
+    case BENCH_STATUS:
+      // Failed polls arrive with version 0 and are retried by the loop
+      if (result.type == RESULT_STATUS && result.status.version != 0) phaseDone = true;
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Called by the UI loop after the results of this pass have been drawn
+void pipelineBenchStep(unsigned long now) {
+  if (phase == BENCH_FINISHED) return;
+
+  if (phase == BENCH_WAIT) {
+    if ((long)(now - nextRunAt) >= 0) startRun();
+    return;
+  }
+
+  if (firstRoutePending) {
+    current.firstRoute = now - current.start;
+    firstRoutePending = false;
+  }
+
+  if (phaseFailed || now - phaseStart > PIPELINE_BENCH_PHASE_TIMEOUT_MS) {
+    finishRun(false, now);
+    return;
+  }
+  if (!phaseDone) return;
+
+  unsigned long took = now - phaseStart;
+  switch (phase) {
+    case BENCH_ROUTES:
+      current.routes = now - current.start;
+      enter(BENCH_TRIPS);
+      onSelectClick();
+      break;
+
+    case BENCH_TRIPS:
+      current.trips = took;
+      enter(BENCH_STATIONS);
+      onSelectClick();
+      break;
+
+    case BENCH_STATIONS:
+      current.stations = took;
+      enter(BENCH_SELECT);
+      onSelectClick();
+      break;
+
+    case BENCH_SELECT:
+      current.select = took;
+      // Skip the "Selected!" hold, it is not part of the pipeline
+      cancelDeferredUi();
+      enter(BENCH_STATUS);
+      getStatus();
+      break;
+
+    case BENCH_STATUS:
+      current.status = took;
+      finishRun(true, now);
+      break;
+
+    default:
+      break;
+  }
+}
+
+unsigned long pipelineBenchMsUntilStep(unsigned long now) {
+  if (phase == BENCH_FINISHED) return ULONG_MAX;
+
+  if (phase == BENCH_WAIT) {
+    long due = (long)(nextRunAt - now);
+    return due > 0 ? due : 0;
+  }
+
+  // Results wake the loop by themselves, only the timeout needs a timer
+  long due = (long)(phaseStart + PIPELINE_BENCH_PHASE_TIMEOUT_MS - now);
+  return due > 0 ? due + 1 : 0;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include "tasks.h"
+// pipelinebench.h declares the end-to-end benchmark run against the replay backend
+//
+// Only built with -D PIPELINE_BENCH (env:replay-bench). From boot it walks the
+// UI like a user would, through the real network task, caches and screens:
+// routes, the first route's trips, the first trip's stations, selecting the
+// first station and waiting for its status. The first run starts with the
+// caches cleared, the PIPELINE_BENCH_RUNS after it are warm. Each run prints
+// one [BENCH] line on Serial.
+
+#ifndef PIPELINE_BENCH_RUNS
+#define PIPELINE_BENCH_RUNS 5
+#endif
+#define PIPELINE_BENCH_PHASE_TIMEOUT_MS 30000
+#define PIPELINE_BENCH_PAUSE_MS 1000
+
+void pipelineBenchStart();
+void pipelineBenchObserve(const NetResult &result);
+void pipelineBenchStep(unsigned long now);
+unsigned long pipelineBenchMsUntilStep(unsigned long now);
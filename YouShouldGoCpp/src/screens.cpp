@@ -0,0 +1,390 @@
+#include "utils.h"
+#include "app.h"
+#include "diag.h"
+#include <time.h>
+#include <algorithm>
+
+// Screens only draw into gfx and never touch the network or NVS, so they
+// also run in the native build against a fake display.
+
+#define LINK_DOT_X 312
+#define LINK_DOT_Y 6
+#define LINK_DOT_R 3
+
+// A dot in the top right corner while WiFi is not up, yellow while
+// connecting and red while waiting to retry. Black erases it.
+static void drawLinkIndicator() {
+  uint16_t color = wifiLink == WIFI_LINK_CONNECTING ? YELLOW : wifiLink == WIFI_LINK_DOWN ? RED : BLACK;
+  gfx->fillCircle(LINK_DOT_X, LINK_DOT_Y, LINK_DOT_R, color);
+}
+
+// Every screen ends here so the indicator survives redraws
+static void present() {
+  drawLinkIndicator();
+  gfx->flush();
+}
+
+void showLinkState() {
+  present();
+}
+
+void showMessage(const String &text, uint16_t color, int textSize, int y) {
+  gfx->fillScreen(BLACK);
+  gfx->setTextSize(textSize);
+  gfx->setTextColor(color);
+  gfx->setCursor(10, y);
+  gfx->println(text);
+  present();
+}
+
+void displayWrappedText(const String &text, int startY) {
+  gfx->setTextSize(1);
+  gfx->setTextColor(WHITE);
+
+  int y = startY;
+  String line = "";
+  const int maxCharsPerLine = 50;
+
+  for (unsigned int i = 0; i < text.length() && y < gfx->height() - 20; i++) {
+    char c = text[i];
+
+    if (c == '\n' || line.length() >= maxCharsPerLine) {
+      gfx->setCursor(10, y);
+      gfx->println(line);
+      y += 12;
+      line = (c == '\n') ? "" : String(c);
+    } else {
+      line += c;
+    }
+  }
+
+  if (line.length() > 0 && y < gfx->height() - 20) {
+    gfx->setCursor(10, y);
+    gfx->println(line);
+  }
+}
+
+void drawClearPopup(unsigned long remainingMs) {
+  int W = gfx->width();
+  int H = gfx->height();
+  int boxW = (W * 2) / 3;
+  int boxH = 50;
+  int boxX = (W - boxW) / 2;
+  int boxY = (H - boxH) / 2;
+  
+  gfx->fillRoundRect(boxX, boxY, boxW, boxH, 6, RED);
+  gfx->drawRoundRect(boxX, boxY, boxW, boxH, 6, WHITE);
+  gfx->setTextColor(WHITE);
+  gfx->setTextSize(2);
+  
+  char buf[32];
+  unsigned long seconds = (remainingMs + 999) / 1000;
+  snprintf(buf, sizeof(buf), "Hold %lus more", (unsigned long)seconds);
+  
+  int textX = boxX + (boxW - strlen(buf) * 12) / 2;
+  gfx->setCursor(textX, boxY + (boxH / 2) - 8);
+  gfx->println(buf);
+  present();
+}
+
+void displayCurrentRoute() {
+  if (!routesLoaded || !routes.has(currentRouteIndex)) {
+    showMessage("No routes loaded", RED);
+    return;
+  }
+
+  Route &route = routes[currentRouteIndex];
+  currentScreen = SCREEN_ROUTES;
+
+  gfx->fillScreen(BLACK);
+
+  gfx->setTextSize(2);
+  gfx->setTextColor(CYAN);
+  gfx->setCursor(10, 10);
+  gfx->printf("%d/%d", currentRouteIndex + 1, (int)routes.size());
+
+  gfx->setTextSize(2);
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 40);
+  gfx->print(route.route_short_name);
+  gfx->println(" -");
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 65);
+  displayWrappedText(route.route_long_name, 65);
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(YELLOW);
+  gfx->setCursor(10, 155);
+  gfx->println("BTN1: Next  BTN2: Select");
+  present();
+}
+
+void displayCurrentTrip() {
+  if (!tripsLoaded || !trips.has(currentTripIndex)) {
+    showMessage("No trips loaded", RED);
+    return;
+  }
+
+  Trip &trip = trips[currentTripIndex];
+  currentScreen = SCREEN_TRIPS;
+
+  gfx->fillScreen(BLACK);
+
+  gfx->setTextSize(2);
+  gfx->setTextColor(CYAN);
+  gfx->setCursor(10, 10);
+  gfx->printf("%d/%d", currentTripIndex + 1, (int)trips.size());
+
+  gfx->setTextSize(2);
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 40);
+  gfx->println("Trip");
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 65);
+  displayWrappedText(trip.trip_headsign, 65);
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(YELLOW);
+  gfx->setCursor(10, 130);
+  gfx->println("Dir: " + String(trip.direction_id));
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(YELLOW);
+  gfx->setCursor(10, 145);
+  gfx->println("BTN1: Next  BTN2: Select");
+  gfx->setCursor(10, 158);
+  gfx->println("Hold BTN2: Routes");
+  present();
+}
+
+void displayCurrentStation() {
+
+  if (!stationsLoaded || !stations.has(currentStationIndex)) {
+    showMessage("No stations loaded", RED);
+    return;
+  }
+
+  Station &station = stations[currentStationIndex];
+  currentScreen = SCREEN_STATIONS;
+
+  gfx->fillScreen(BLACK);
+
+  gfx->setTextSize(2);
+  gfx->setTextColor(CYAN);
+  gfx->setCursor(10, 10);
+  gfx->printf("%d/%d", station.sequence, (int)stations.size());
+
+  gfx->setTextSize(2);
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 40);
+
+  String name = station.name;
+  if (name.length() > 18) {
+    int spacePos = name.lastIndexOf(' ', 18);
+    if (spacePos > 0) {
+      gfx->println(name.substring(0, spacePos));
+      gfx->setCursor(10, 60);
+      gfx->println(name.substring(spacePos + 1));
+    } else {
+      gfx->println(name.substring(0, 18));
+      gfx->setCursor(10, 60);
+      gfx->println(name.substring(18));
+    }
+  } else {
+    gfx->println(name);
+  }
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(YELLOW);
+  gfx->setCursor(10, 145);
+  gfx->println("BTN1: Next  BTN2: Select");
+  gfx->setCursor(10, 158);
+  gfx->println("Hold BTN2: Routes");
+  present();
+}
+
+void displayStatus(const CompactStatus &status) {
+  currentScreen = SCREEN_STATUS;
+
+  gfx->fillScreen(BLACK);
+  gfx->setTextSize(2);
+  gfx->setTextColor(GREEN);
+  gfx->setCursor(10, 10);
+  gfx->println("Tram Status:");
+
+  if (status.version == 0) {
+    present();
+    return;  // nothing received yet, the first result redraws
+  }
+
+  // When the backend read the positions, so a stale screen is recognisable
+  if (status.dataTimestamp > 0) {
+    char stamp[16];
+    time_t t = status.dataTimestamp;
+    struct tm local;
+    localtime_r(&t, &local);
+    strftime(stamp, sizeof(stamp), "as of %H:%M:%S", &local);
+    gfx->setTextSize(1);
+    gfx->setTextColor(DARKGREY);
+    gfx->setCursor(220, 16);
+    gfx->println(stamp);
+  }
+
+  char headline[40];
+  formatStatusHeadline(status, headline, sizeof(headline));
+  gfx->setTextSize(3);
+  gfx->setTextColor(YELLOW);
+  gfx->setCursor(10, 50);
+  gfx->println(headline);
+
+  // Only for a status computed on the device, the backend's has no estimate
+  int listY = 90;
+  char hint[32];
+  if (formatLeaveHint(status, hint, sizeof(hint))) {
+    gfx->setTextSize(2);
+    gfx->setTextColor(GREEN);
+    gfx->setCursor(10, 80);
+    gfx->println(hint);
+    listY = 100;
+  }
+
+  if (status.state == TRAM_APPROACHING) {
+    gfx->setTextSize(1);
+    gfx->setTextColor(CYAN);
+    for (int i = 0; i < status.count; i++) {
+      const CompactVehicle &vehicle = status.vehicles[i];
+      gfx->setCursor(10, listY + i * 10);
+      if (vehicle.vehicleId >= 0) {
+        gfx->printf("Tram %ld: ", (long)vehicle.vehicleId);
+      } else {
+        gfx->print("Tram: ");
+      }
+      gfx->printf("%d stop%s away", vehicle.stopsAway, vehicle.stopsAway == 1 ? "" : "s");
+      if (status.flags & COMPACT_STATUS_HAS_ETA) {
+        gfx->printf(", ~%d min", (vehicle.etaS + 30) / 60);
+      }
+    }
+  }
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 145);
+  gfx->println("BTN1: Back  BTN2: Refresh");
+  present();
+}
+
+// Every watched stop, one row each with its nearest vehicle. A single stop
+// without a highlighted row gets the full status screen instead. cursor is
+// the highlighted row, -1 for none.
+void displayWatchlist(const Watchlist &watches, const StatusBatch &batch, int cursor) {
+  static const CompactStatus none = {};
+
+  if (watches.count() == 1 && cursor < 0) {
+    displayStatus(batch.count > 0 ? batch.status[0] : none);
+    return;
+  }
+  currentScreen = SCREEN_STATUS;
+
+  gfx->fillScreen(BLACK);
+  gfx->setTextSize(2);
+  gfx->setTextColor(GREEN);
+  gfx->setCursor(10, 10);
+  gfx->println("Watched stops:");
+
+  // Large rows while they fit, 5 x 22 px between the title and the footer
+  int textSize = watches.count() <= 5 ? 2 : 1;
+  int rowHeight = textSize == 2 ? 22 : 14;
+  int columns = (gfx->width() - 20) / (6 * textSize);
+  gfx->setTextSize(textSize);
+
+  for (int i = 0; i < watches.count(); i++) {
+    const Watch &watch = watches[i];
+    int y = 34 + i * rowHeight;
+
+    char state[16];
+    formatStatusShort(i < batch.count ? batch.status[i] : none, state, sizeof(state));
+    int stateLength = strlen(state);
+
+    // The stop name gets whatever the state leaves
+    char name[48];
+    snprintf(name, sizeof(name), "%s %s", watch.routeName, watch.stopName);
+    int nameLength = std::max(0, columns - stateLength - 1);
+    if ((int)strlen(name) > nameLength) name[nameLength] = '\0';
+
+    if (i == cursor) {
+      gfx->fillRect(4, y - 2, gfx->width() - 8, rowHeight - 2, DARKGREY);
+    }
+    gfx->setTextColor(WHITE);
+    gfx->setCursor(10, y);
+    gfx->print(name);
+    gfx->setTextColor(YELLOW);
+    gfx->setCursor(gfx->width() - 10 - stateLength * 6 * textSize, y);
+    gfx->print(state);
+  }
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 155);
+  gfx->println(cursor < 0 ? "BTN1: Pick a stop  BTN2: Back" : "BTN1: Next  BTN2: Stop watching");
+  present();
+}
+
+// Heap, PSRAM and stack figures plus the latest samples, from diag.cpp
+void displayDiagnostics() {
+  currentScreen = SCREEN_DIAG;
+
+  uint32_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  uint32_t minFree = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  uint32_t psramTotal = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+
+  gfx->fillScreen(BLACK);
+  gfx->setTextSize(2);
+  gfx->setTextColor(GREEN);
+  gfx->setCursor(10, 10);
+  gfx->println("Diagnostics");
+
+  gfx->setTextSize(1);
+  gfx->setTextColor(DARKGREY);
+  gfx->setCursor(220, 16);
+  gfx->printf("up %lus", millis() / 1000);
+
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 34);
+  gfx->printf("Heap %lu  min %lu  largest %lu", (unsigned long)freeHeap, (unsigned long)minFree, (unsigned long)largest);
+  gfx->setCursor(10, 46);
+  if (psramTotal > 0) {
+    gfx->printf("PSRAM %lu of %lu", (unsigned long)heap_caps_get_free_size(MALLOC_CAP_SPIRAM), (unsigned long)psramTotal);
+  } else {
+    gfx->print("No PSRAM");
+  }
+
+  DiagTaskStack stacks[DIAG_MAX_TASKS];
+  size_t taskCount = diagTaskStacks(stacks, DIAG_MAX_TASKS);
+  gfx->setTextColor(CYAN);
+  gfx->setCursor(10, 58);
+  gfx->print("Stack free:");
+  for (size_t i = 0; i < taskCount; i++) {
+    gfx->printf(" %s %lu", stacks[i].name, (unsigned long)stacks[i].stackFree);
+  }
+
+  // Newest first, as many as fit above the hint line
+  DiagSample samples[7];
+  size_t sampleCount = diagRecent(samples, 7);
+  gfx->setTextColor(YELLOW);
+  for (size_t i = 0; i < sampleCount; i++) {
+    const DiagSample &sample = samples[i];
+    gfx->setCursor(10, 74 + i * 10);
+    gfx->printf("%6lus %-13s %s %6lu %6lu", (unsigned long)(sample.ms / 1000), diagOpName(sample.op),
+                sample.phase == DIAG_BEGIN ? ">" : "<", (unsigned long)sample.freeHeap, (unsigned long)sample.largestBlock);
+  }
+
+  gfx->setTextColor(WHITE);
+  gfx->setCursor(10, 155);
+  gfx->println("BTN1: Refresh  BTN2: Back");
+  present();
+}
@@ -0,0 +1,86 @@
+#include "standby.h"
+#include "utils.h"
+#include "buttons.h"
+#include <esp_sleep.h>
+#include <driver/rtc_io.h>
+
+#define RTC_STATE_MAGIC 0x59534732  // "YSG2"
+
+// Survives deep sleep (but not a power cycle or reset)
+struct RtcState {
+  uint32_t magic;
+  Screen screen;
+  int routeIndex;
+  int tripIndex;
+  int stationIndex;
+  char tripId[WATCH_TRIP_ID_LEN];  // the stations screen's trip
+  char routeName[WATCH_ROUTE_NAME_LEN];
+  CompactStatus lastStatus;
+};
+
+RTC_DATA_ATTR static RtcState rtcState;
+
+// Returns true when this boot is a wake from standby with valid saved state.
+// The indices and screen are restored into the globals, the lists are not:
+// they are loaded on demand when the user navigates away from the status.
+bool restoreFromStandby(CompactStatus &lastStatus) {
+  // Hand the wake pins back to the digital GPIO matrix for initButtons()
+  rtc_gpio_deinit((gpio_num_t)BTN_NEXT);
+  rtc_gpio_deinit((gpio_num_t)BTN_SELECT);
+
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED || rtcState.magic != RTC_STATE_MAGIC) {
+    return false;
+  }
+
+  currentScreen = rtcState.screen;
+  currentRouteIndex = rtcState.routeIndex;
+  currentTripIndex = rtcState.tripIndex;
+  currentStationIndex = rtcState.stationIndex;
+  strlcpy(selectedTripId, rtcState.tripId, sizeof(selectedTripId));
+  strlcpy(selectedRouteName, rtcState.routeName, sizeof(selectedRouteName));
+  lastStatus = rtcState.lastStatus;
+
+  // One-shot, a later reset must not resume from stale state
+  rtcState.magic = 0;
+
+  Serial.println("[STANDBY] Woke from standby, screen " + String(currentScreen));
+  return true;
+}
+
+bool wokeByTimer() {
+  return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+void enterStandby(const CompactStatus &lastStatus) {
+  Serial.println("[STANDBY] Entering deep sleep");
+
+  rtcState.magic = RTC_STATE_MAGIC;
+  rtcState.screen = currentScreen;
+  rtcState.routeIndex = currentRouteIndex;
+  rtcState.tripIndex = currentTripIndex;
+  rtcState.stationIndex = currentStationIndex;
+  strlcpy(rtcState.tripId, selectedTripId, sizeof(rtcState.tripId));
+  strlcpy(rtcState.routeName, selectedRouteName, sizeof(rtcState.routeName));
+  rtcState.lastStatus = lastStatus;
+
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  displayPowerDown();
+
+  // Either button pulls its line low; keep the pull-ups alive while asleep
+  rtc_gpio_pullup_en((gpio_num_t)BTN_NEXT);
+  rtc_gpio_pulldown_dis((gpio_num_t)BTN_NEXT);
+  rtc_gpio_pullup_en((gpio_num_t)BTN_SELECT);
+  rtc_gpio_pulldown_dis((gpio_num_t)BTN_SELECT);
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+
+  esp_sleep_enable_ext1_wakeup((1ULL << BTN_NEXT) | (1ULL << BTN_SELECT), ESP_EXT1_WAKEUP_ANY_LOW);
+
+  // Only the status screen has anything worth refreshing unattended
+  if (currentScreen == SCREEN_STATUS) {
+    esp_sleep_enable_timer_wakeup((uint64_t)STANDBY_TIMER_WAKE_MS * 1000);
+  }
+
+  Serial.flush();
+  esp_deep_sleep_start();
+}
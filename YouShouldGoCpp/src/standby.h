@@ -0,0 +1,14 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include "compactstatus.h"
+// standby.h declares deep-sleep standby and the state kept in RTC memory across it
+
+#define STANDBY_INACTIVITY_MS (5UL * 60 * 1000)      // no button press for this long
+#define STANDBY_PASSED_DELAY_MS (60UL * 1000)        // after "all vehicles passed your stop"
+#define STANDBY_TIMER_WAKE_MS (30UL * 60 * 1000)     // periodic wake to refresh the status
+#define STANDBY_TIMER_AWAKE_MS (30UL * 1000)         // stay up this long after a timer wake
+
+bool restoreFromStandby(CompactStatus &lastStatus);
+bool wokeByTimer();
+void enterStandby(const CompactStatus &lastStatus);
@@ -0,0 +1,54 @@
+#include "statuspoll.h"
+
+static int consecutiveFailures = 0;
+
+void resetStatusPoll() {
+  consecutiveFailures = 0;
+}
+
+// Interval for a successful poll, from how close the tram is
+static unsigned long intervalForStatus(const CompactStatus &status) {
+  if (status.state == TRAM_ALL_PASSED) {
+    return STATUS_POLL_IDLE_MS;
+  }
+  if (status.state != TRAM_APPROACHING || status.count == 0) {
+    return STATUS_POLL_NEAR_MS;
+  }
+
+  int stops = status.vehicles[0].stopsAway;
+  if (stops > STATUS_NEAR_STOPS) {
+    return STATUS_POLL_FAR_MS;
+  }
+
+  // "2 stops away" is still polled fast so "Next Stop" is never seen late
+  return (stops == 1 || stops == 2) ? STATUS_POLL_FAST_MS : STATUS_POLL_NEAR_MS;
+}
+
+// Exponential backoff with equal jitter, so devices that lost the server at
+// the same moment do not come back in lockstep
+static unsigned long backoffDelay() {
+  int shift = min(consecutiveFailures - 1, 16);
+  unsigned long delayMs = min((unsigned long)STATUS_BACKOFF_BASE_MS << shift, (unsigned long)STATUS_BACKOFF_MAX_MS);
+  return delayMs / 2 + random(delayMs / 2 + 1);
+}
+
+// Called with every status poll result, returns how long to wait before the
+// next one. retryAfterMs is the server's Retry-After hint, 0 when absent.
+unsigned long nextStatusPollDelay(int httpCode, const CompactStatus &status, unsigned long retryAfterMs) {
+  unsigned long delayMs;
+
+  if (httpCode == HTTP_CODE_OK && status.version != 0) {
+    consecutiveFailures = 0;
+    delayMs = intervalForStatus(status);
+  } else {
+    consecutiveFailures++;
+    delayMs = backoffDelay();
+    Serial.println("[STATUS] Poll failed (" + String(httpCode) + "), attempt " + String(consecutiveFailures));
+  }
+
+  if (retryAfterMs > 0) {
+    delayMs = max(delayMs, min(retryAfterMs, (unsigned long)STATUS_RETRY_HINT_MAX_MS));
+  }
+
+  return delayMs;
+}
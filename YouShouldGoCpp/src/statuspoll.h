@@ -0,0 +1,18 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include "compactstatus.h"
+// statuspoll.h declares the scheduler that decides when the status screen polls next
+
+#define STATUS_POLL_FAST_MS 2000        // "Next Stop", the moment the user should go
+#define STATUS_POLL_NEAR_MS 5000        // up to STATUS_NEAR_STOPS away
+#define STATUS_POLL_FAR_MS 15000
+#define STATUS_POLL_IDLE_MS 60000       // all vehicles passed
+#define STATUS_NEAR_STOPS 4
+
+#define STATUS_BACKOFF_BASE_MS 2000
+#define STATUS_BACKOFF_MAX_MS 120000
+#define STATUS_RETRY_HINT_MAX_MS 600000  // ignore absurd Retry-After values
+
+void resetStatusPoll();
+unsigned long nextStatusPollDelay(int httpCode, const CompactStatus &status, unsigned long retryAfterMs);
@@ -0,0 +1,230 @@
+#include "statusstream.h"
+#include "tasks.h"
+#include "compactstatus.h"
+#include "diag.h"
+#include "net.h"
+
+#define STREAM_PATH "/api/status/stream"
+#define STREAM_IDLE_TIMEOUT_MS 45000    // the server sends a comment every 15 s
+#define STREAM_RETRY_DEFAULT_MS 3000    // until the server sends its own retry:
+#define STREAM_MAX_FAILURES 3           // then leave it to polling for a while
+#define STREAM_GIVE_UP_MS (5UL * 60 * 1000)
+
+static TaskHandle_t streamTaskHandle = NULL;
+static volatile bool streamWanted = false;
+static volatile bool streamLive = false;
+
+static WiFiClientSecure streamSecureClient;
+static WiFiClient streamPlainClient;  // http:// serverUrl, the local replay backend
+static HTTPClient streamHttp;
+
+static char lastEventId[24] = "";
+static unsigned long retryMs = STREAM_RETRY_DEFAULT_MS;
+
+// text/event-stream parser state, fed one byte at a time
+static char line[128];
+static size_t lineLength = 0;
+static bool lineOverflow = false;
+static char eventId[24];
+static bool eventHasId = false;
+static char eventName[16];
+static char eventData[2 * sizeof(CompactStatus) + 1];  // hex payload
+static bool eventHasData = false;
+
+static void resetEvent() {
+  eventHasId = false;
+  eventName[0] = '\0';
+  eventData[0] = '\0';
+  eventHasData = false;
+}
+
+static void dispatchEvent() {
+  if (eventHasId) {
+    strlcpy(lastEventId, eventId, sizeof(lastEventId));
+  }
+
+  if (eventHasData && (eventName[0] == '\0' || strcmp(eventName, "status") == 0)) {
+    NetResult result = {};
+    result.type = RESULT_STATUS;
+    result.httpCode = HTTP_CODE_OK;
+    if (decodeCompactStatusHex(eventData, result.status)) {
+      Serial.println("[STREAM] Event " + String(lastEventId));
+      postNetResult(result);
+    } else {
+      Serial.println("[STREAM] ERROR: Bad status payload");
+    }
+  }
+
+  resetEvent();
+}
+
+static void processLine() {
+  if (lineLength == 0) {
+    dispatchEvent();
+    return;
+  }
+  if (line[0] == ':') {
+    return;  // comment / heartbeat
+  }
+
+  char *value = strchr(line, ':');
+  if (value) {
+    *value++ = '\0';
+    if (*value == ' ') value++;
+  } else {
+    value = line + lineLength;  // field name only, empty value
+  }
+
+  if (strcmp(line, "data") == 0) {
+    if (eventHasData) {
+      strlcat(eventData, "\n", sizeof(eventData));
+    }
+    strlcat(eventData, value, sizeof(eventData));
+    eventHasData = true;
+  } else if (strcmp(line, "id") == 0) {
+    strlcpy(eventId, value, sizeof(eventId));
+    eventHasId = true;
+  } else if (strcmp(line, "event") == 0) {
+    strlcpy(eventName, value, sizeof(eventName));
+  } else if (strcmp(line, "retry") == 0) {
+    long ms = atol(value);
+    if (ms > 0) retryMs = ms;
+  }
+}
+
+static void feed(char c) {
+  if (c == '\r') {
+    return;
+  }
+  if (c != '\n') {
+    // Overlong lines are dropped whole rather than parsed truncated
+    if (lineLength < sizeof(line) - 1) {
+      line[lineLength++] = c;
+    } else {
+      lineOverflow = true;
+    }
+    return;
+  }
+
+  line[lineLength] = '\0';
+  if (!lineOverflow) {
+    processLine();
+  }
+  lineLength = 0;
+  lineOverflow = false;
+}
+
+static WiFiClient &streamClient() {
+  if (strncmp(serverUrl, "http://", 7) == 0) return streamPlainClient;
+  return streamSecureClient;
+}
+
+static bool openStream() {
+  streamSecureClient.setInsecure();
+  // HTTP/1.0 so the reply comes unchunked and can be parsed straight off the socket
+  streamHttp.useHTTP10(true);
+
+  if (!streamHttp.begin(streamClient(), String(serverUrl) + STREAM_PATH)) {
+    return false;
+  }
+  streamHttp.addHeader("Accept", "text/event-stream");
+  streamHttp.addHeader("X-Device-Id", deviceId());
+  if (lastEventId[0] != '\0') {
+    streamHttp.addHeader("Last-Event-ID", lastEventId);
+  }
+
+  int httpCode = streamHttp.GET();
+  if (httpCode != HTTP_CODE_OK) {
+    Serial.println("[STREAM] Open failed: " + String(httpCode));
+    return false;
+  }
+  return true;
+}
+
+static void setLive(bool live) {
+  streamLive = live;
+  wakeUi();  // polling stops or resumes
+}
+
+static void readStream() {
+  WiFiClient *stream = streamHttp.getStreamPtr();
+  unsigned long lastByte = millis();
+
+  lineLength = 0;
+  lineOverflow = false;
+  resetEvent();
+
+  while (streamWanted) {
+    int n = stream->available();
+    if (n <= 0) {
+      if (!stream->connected()) {
+        Serial.println("[STREAM] Closed by server");
+        return;
+      }
+      if (millis() - lastByte > STREAM_IDLE_TIMEOUT_MS) {
+        Serial.println("[STREAM] No heartbeat, reconnecting");
+        return;
+      }
+      // setStatusStreamWanted(false) cuts this short
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+      continue;
+    }
+
+    lastByte = millis();
+    while (n-- > 0) {
+      feed((char)stream->read());
+    }
+  }
+}
+
+static void streamTask(void *) {
+  int failures = 0;
+
+  for (;;) {
+    if (!streamWanted || WiFi.status() != WL_CONNECTED) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    if (openStream()) {
+      Serial.println("[STREAM] Connected");
+      failures = 0;
+      setLive(true);
+      readStream();
+      setLive(false);
+    } else {
+      failures++;
+    }
+
+    streamHttp.end();
+    streamClient().stop();
+
+    if (!streamWanted) continue;
+
+    unsigned long waitMs = retryMs;
+    if (failures >= STREAM_MAX_FAILURES) {
+      Serial.println("[STREAM] Unavailable, polling instead");
+      failures = 0;
+      waitMs = STREAM_GIVE_UP_MS;
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+  }
+}
+
+void startStatusStreamTask() {
+  xTaskCreatePinnedToCore(streamTask, "stream", 8192, NULL, 1, &streamTaskHandle, 0);
+  diagRegisterTask(streamTaskHandle, "stream");
+}
+
+// Called by the UI loop every pass, only a change wakes the stream task
+void setStatusStreamWanted(bool wanted) {
+  if (wanted == streamWanted) return;
+  streamWanted = wanted;
+  if (streamTaskHandle) {
+    xTaskNotifyGive(streamTaskHandle);
+  }
+}
+
+bool statusStreamLive() {
+  return streamLive;
+}
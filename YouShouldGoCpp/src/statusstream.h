@@ -0,0 +1,13 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+// statusstream.h declares the Server-Sent Events client for /api/status/stream
+//
+// The stream runs on its own task and connection so it does not hold up the
+// network task. Every status event is delivered to the UI as a RESULT_STATUS,
+// the same as a poll. While the stream is live the UI stops polling; when it
+// drops (or cannot be opened) polling takes over again.
+
+void startStatusStreamTask();
+void setStatusStreamWanted(bool wanted);
+bool statusStreamLive();
@@ -0,0 +1,235 @@
+#include "tasks.h"
+#include "utils.h"
+#include "net.h"
+#include "diag.h"
+#include <limits.h>
+
+#define NET_TASK_CORE 0
+#define NET_TASK_STACK 16384
+#define NET_TASK_PRIORITY 1
+#define REQUEST_QUEUE_LENGTH 8
+#define RESULT_QUEUE_LENGTH 8
+#define WARM_QUEUE_LENGTH 4        // NET_WARM_* wait here, never in the user's requestQueue
+#define WARM_BYTES_PER_MIN 32768   // body bytes warming may download per minute
+#define WARM_MIN_FREE_HEAP 65536   // internal heap warming leaves for the user's own loads
+
+static QueueHandle_t requestQueue = NULL;
+static QueueHandle_t resultQueue = NULL;
+static QueueHandle_t warmQueue = NULL;
+static QueueSetHandle_t requestSet = NULL;
+static TaskHandle_t networkTaskHandle = NULL;
+static TaskHandle_t uiTaskHandle = NULL;
+static uint32_t nextSeq = 1;
+
+static volatile uint32_t warmGeneration = 0;
+static unsigned long warmWindowStart = 0;  // network task only
+static uint32_t warmWindowBytes = 0;
+
+// Which diagnostics bucket a request is sampled into
+static DiagOp diagOpFor(NetRequestType type) {
+  switch (type) {
+    case NET_LOAD_ROUTES: return DIAG_FETCH_ROUTES;
+    case NET_LOAD_TRIPS: return DIAG_FETCH_TRIPS;
+    case NET_LOAD_STATIONS: return DIAG_FETCH_STATIONS;
+    case NET_SELECT_STATION: return DIAG_SELECT_STATION;
+    case NET_FETCH_STATUS: return DIAG_STATUS_POLL;
+    case NET_WARM_TRIPS:
+    case NET_WARM_STATIONS: return DIAG_WARM;
+    default: return DIAG_OP_COUNT;
+  }
+}
+
+// Warming only runs while the user is still where it was queued, and within
+// its byte and heap caps
+static bool warmAllowed(const NetRequest &request) {
+  if (request.warmGeneration != warmGeneration || wifiLink != WIFI_LINK_UP) {
+    return false;
+  }
+
+  unsigned long now = millis();
+  if (now - warmWindowStart >= 60000) {
+    warmWindowStart = now;
+    warmWindowBytes = 0;
+  }
+  if (warmWindowBytes >= WARM_BYTES_PER_MIN) {
+    Serial.println("[WARM] Byte budget used up for this minute");
+    return false;
+  }
+  if (heap_caps_get_free_size(MALLOC_CAP_INTERNAL) < WARM_MIN_FREE_HEAP) {
+    Serial.println("[WARM] Heap too low, not warming");
+    return false;
+  }
+  return true;
+}
+
+static void handleRequest(const NetRequest &request) {
+  // Drop the kept-alive connection and DNS cache after a WiFi outage
+  if (WiFi.status() != WL_CONNECTED) {
+    netReset();
+  }
+
+  switch (request.type) {
+    case NET_LOAD_ROUTES:
+      fetchRoutes(request.seq, request.offset);
+      break;
+
+    case NET_LOAD_TRIPS:
+      fetchTrips(request.seq, request.routeId, request.offset);
+      break;
+
+    case NET_LOAD_STATIONS:
+      fetchStations(request.seq, request.tripId, request.offset);
+      break;
+
+    case NET_SELECT_STATION: {
+      NetResult result = {};
+      result.type = RESULT_STATION_SELECTED;
+      result.seq = request.seq;
+      result.httpCode = postUserLocation(request.lat, request.lon, String(request.name), request.tripId);
+      strlcpy(result.text, request.name, sizeof(result.text));
+      postNetResult(result);
+      break;
+    }
+
+    case NET_FETCH_STATUS: {
+      NetResult result = {};
+      result.type = RESULT_STATUS;
+      result.seq = request.seq;
+      unsigned long retryAfterMs = 0;
+      if (request.watches) {
+        result.batch = new StatusBatch();
+        result.httpCode = fetchWatchStatuses(*request.watches, *result.batch, retryAfterMs);
+        result.status = mostUrgentStatus(*result.batch);
+      } else {
+        result.httpCode = fetchStatus(result.status, retryAfterMs);
+      }
+      result.retryAfterMs = retryAfterMs;
+      postNetResult(result);
+      break;
+    }
+
+    case NET_SAVE_WATCHES:
+      if (request.watches) saveWatchlist(*request.watches);
+      break;
+
+    case NET_CLEAR_CACHE:
+      clearNVS();
+      break;
+
+    case NET_WARM_TRIPS:
+    case NET_WARM_STATIONS: {
+      if (!warmAllowed(request)) break;
+      uint32_t before = netBodyBytes();
+      if (request.type == NET_WARM_TRIPS) {
+        warmTrips(request.seq, request.routeId);
+      } else {
+        warmStations(request.seq, request.tripId);
+      }
+      warmWindowBytes += netBodyBytes() - before;
+      break;
+    }
+  }
+}
+
+// The user's own requests always run before queued warming
+static bool nextRequest(NetRequest &request) {
+  if (xQueueSelectFromSet(requestSet, portMAX_DELAY) == NULL) {
+    return false;
+  }
+  return xQueueReceive(requestQueue, &request, 0) == pdTRUE || xQueueReceive(warmQueue, &request, 0) == pdTRUE;
+}
+
+static void networkTask(void *param) {
+  NetRequest request;
+
+  for (;;) {
+    if (nextRequest(request)) {
+      DiagOp op = diagOpFor(request.type);
+      diagSample(op, DIAG_BEGIN);
+      handleRequest(request);
+      diagSample(op, DIAG_END);
+      delete request.watches;
+    }
+  }
+}
+
+// Called from setup(), which runs on the same task as loop()
+void startNetworkTask() {
+  uiTaskHandle = xTaskGetCurrentTaskHandle();
+  requestQueue = xQueueCreate(REQUEST_QUEUE_LENGTH, sizeof(NetRequest));
+  resultQueue = xQueueCreate(RESULT_QUEUE_LENGTH, sizeof(NetResult));
+  warmQueue = xQueueCreate(WARM_QUEUE_LENGTH, sizeof(NetRequest));
+  requestSet = xQueueCreateSet(REQUEST_QUEUE_LENGTH + WARM_QUEUE_LENGTH);
+  xQueueAddToSet(requestQueue, requestSet);
+  xQueueAddToSet(warmQueue, requestSet);
+
+  xTaskCreatePinnedToCore(networkTask, "net", NET_TASK_STACK, NULL, NET_TASK_PRIORITY, &networkTaskHandle, NET_TASK_CORE);
+  diagRegisterTask(networkTaskHandle, "net");
+  Serial.println("[TASK] Network task started on core " + String(NET_TASK_CORE));
+}
+
+// UI side: assigns the request a sequence number so stale results can be
+// told apart, returns 0 if the queue is full. Warming has a queue of its
+// own, so it can never take a slot from a load the user is waiting for.
+uint32_t postNetRequest(NetRequest &request) {
+  request.seq = nextSeq++;
+  request.warmGeneration = warmGeneration;
+  bool warm = request.type == NET_WARM_TRIPS || request.type == NET_WARM_STATIONS;
+  if (xQueueSend(warm ? warmQueue : requestQueue, &request, 0) != pdTRUE) {
+    if (!warm) {
+      Serial.println("[TASK] WARNING: request queue full, dropping request " + String(request.type));
+    }
+    delete request.watches;
+    request.watches = nullptr;
+    return 0;
+  }
+  return request.seq;
+}
+
+void cancelWarming() {
+  warmGeneration++;
+}
+
+void postNetResult(NetResult &result) {
+  // Block rather than drop, the UI drains the queue every loop
+  if (xQueueSend(resultQueue, &result, portMAX_DELAY) != pdTRUE) {
+    freeNetResult(result);
+    return;
+  }
+  wakeUi();
+}
+
+void postNetError(uint32_t seq, const String &message) {
+  NetResult result = {};
+  result.type = RESULT_ERROR;
+  result.seq = seq;
+  strlcpy(result.text, message.c_str(), sizeof(result.text));
+  postNetResult(result);
+}
+
+bool receiveNetResult(NetResult &result, uint32_t waitMs) {
+  return xQueueReceive(resultQueue, &result, pdMS_TO_TICKS(waitMs)) == pdTRUE;
+}
+
+void freeNetResult(NetResult &result) {
+  delete result.routes;
+  delete result.trips;
+  delete result.stations;
+  delete result.batch;
+  result.routes = nullptr;
+  result.trips = nullptr;
+  result.stations = nullptr;
+  result.batch = nullptr;
+}
+
+// Producers (network task, button timers) call this after queueing something
+void wakeUi() {
+  if (uiTaskHandle) {
+    xTaskNotifyGive(uiTaskHandle);
+  }
+}
+
+// Blocks the UI loop until woken or timeoutMs passes (ULONG_MAX = forever)
+void waitForUi(unsigned long timeoutMs) {
+  ulTaskNotifyTake(pdTRUE, timeoutMs == ULONG_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs));
+}
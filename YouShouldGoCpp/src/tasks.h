@@ -0,0 +1,78 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include "compactstatus.h"
+#include "watchlist.h"
+// tasks.h declares the network worker task and the messages it exchanges with the UI loop
+//
+// All HTTP and NVS work runs on the network task (core 0). The Arduino loop
+// (core 1) is the UI task: it reads the buttons, posts NetRequests and
+// renders the NetResults that come back, without ever waiting on I/O.
+
+enum NetRequestType {
+  NET_LOAD_ROUTES,
+  NET_LOAD_TRIPS,
+  NET_LOAD_STATIONS,
+  NET_SELECT_STATION,
+  NET_FETCH_STATUS,
+  NET_SAVE_WATCHES,
+  NET_CLEAR_CACHE,
+  NET_WARM_TRIPS,     // speculative, see warmTrips()
+  NET_WARM_STATIONS
+};
+
+// watches is a heap copy of the UI's watchlist, owned by the network task
+// once the request is queued
+struct NetRequest {
+  NetRequestType type;
+  uint32_t seq;
+  int routeId;
+  int offset;          // first record of the page to load
+  double lat;
+  double lon;
+  char name[64];
+  char tripId[WATCH_TRIP_ID_LEN];  // stations of this trip (or the one a station is selected on), empty for the session's
+  Watchlist *watches;  // NET_FETCH_STATUS (nullptr: the backend's own stop) and NET_SAVE_WATCHES
+  uint32_t warmGeneration;  // set by postNetRequest(), NET_WARM_* are skipped once it is outdated
+};
+
+enum NetResultType {
+  RESULT_ROUTES,
+  RESULT_TRIPS,
+  RESULT_STATIONS,
+  RESULT_STATION_SELECTED,
+  RESULT_STATUS,
+  RESULT_ERROR
+};
+
+// Pages are heap allocated by the network task and owned by whoever
+// receives the result. Every list load ends with exactly one result that is
+// not fromCache (possibly an empty page that only updates total) or an error.
+struct NetResult {
+  NetResultType type;
+  uint32_t seq;        // seq of the request this answers
+  int httpCode;
+  bool fromCache;      // list came from NVS, a fresher one may follow
+  int routeId;
+  int offset;          // list index of the first record in the page
+  int total;           // records in the whole list
+  uint32_t retryAfterMs;  // server Retry-After hint, 0 when absent
+  CompactStatus status;   // RESULT_STATUS payload, version 0 when the fetch failed
+  StatusBatch *batch;     // every watched stop, status is then the most urgent of them
+  ListPage<Route> *routes;    // pages own the arena their strings live in
+  ListPage<Trip> *trips;
+  ListPage<Station> *stations;
+  char text[64];       // station name or error message
+  char tripId[WATCH_TRIP_ID_LEN];  // RESULT_STATIONS: the trip the stations are of
+};
+
+void startNetworkTask();
+void wakeUi();
+void waitForUi(unsigned long timeoutMs);
+uint32_t postNetRequest(NetRequest &request);
+// The user moved on, queued NET_WARM_* requests are skipped
+void cancelWarming();
+void postNetResult(NetResult &result);
+void postNetError(uint32_t seq, const String &message);
+bool receiveNetResult(NetResult &result, uint32_t waitMs);
+void freeNetResult(NetResult &result);
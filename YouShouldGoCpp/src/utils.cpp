@@ -1,79 +1,44 @@
 #include "utils.h"
 #include "app.h"
+#include "net.h"
+#include "cache.h"
+#include "catalog.h"
+#include "kvstore.h"
+#include "cacheindex.h"
+#include "display.h"
+#include "tasks.h"
+#include "diag.h"
+#include "localstatus.h"
+#include "watchlist.h"
+#include "statuspoll.h"
 
 
 #define PIN_POWER 15
+#define LOADING_MESSAGE_DELAY 150  // only show "Loading..." if the cache does not answer first
+#define STATIONS_REVALIDATED_MAX 16  // trips whose cached stations were checked this boot
+#define FEED_RETRY_BASE_MS 60000     // the vehicle feed is asked for again after this, doubling
+#define FEED_RETRY_MAX_MS 1800000
 #define PIN_BACKLIGHT 38
 
 Arduino_DataBus *bus = new Arduino_ESP32PAR8Q(7, 6, 8, 9, 39, 40, 41, 42, 45, 46, 47, 48);
-Arduino_GFX *gfx = new Arduino_ST7789(bus, 5, 0, true, 170, 320, 35, 0, 35, 0);
+Arduino_GFX *panel = new Arduino_ST7789(bus, 5, 0, true, 170, 320, 35, 0, 35, 0);
+// All drawing goes to the off-screen canvas, screens call gfx->flush() when done
+Arduino_GFX *gfx = new DiffCanvas(320, 170, panel);
 
 Preferences preferences;
 
-const char* getNVSErrorString(esp_err_t err) {
-  switch (err) {
-    case ESP_OK:
-      return "OK";
-    case ESP_ERR_NVS_NOT_FOUND:
-      return "NOT_FOUND";
-    case ESP_ERR_NVS_NOT_ENOUGH_SPACE:
-      return "NOT_ENOUGH_SPACE";
-    case ESP_ERR_NVS_INVALID_HANDLE:
-      return "INVALID_HANDLE";
-    case ESP_ERR_NVS_INVALID_NAME:
-      return "INVALID_NAME";
-    case ESP_ERR_NVS_INVALID_LENGTH:
-      return "INVALID_LENGTH";
-    case ESP_ERR_NVS_NOT_INITIALIZED:
-      return "NOT_INITIALIZED";
-    default:
-      return "UNKNOWN";
-  }
-}
-
-void nvsOpen() {
-  if (nvsHandle) {
-    Serial.println("[NVS] Handle already open");
-    return;
-  }
-  Serial.println("[NVS] Opening namespace 'transit'...");
-  nvsErr = nvs_open("transit", NVS_READWRITE, &nvsHandle);
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_open failed: " + String(getNVSErrorString(nvsErr)));
-    nvsHandle = 0;
-  } else {
-    Serial.println("[NVS] Namespace opened successfully");
-  }
-}
-
 void initNVS() {
-  Serial.println("[NVS] Initializing NVS...");
-  nvsErr = nvs_flash_init();
-  if (nvsErr == ESP_ERR_NVS_NO_FREE_PAGES || nvsErr == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-    Serial.println("[NVS] NVS flash corrupted, erasing...");
-    nvs_flash_erase();
-    nvs_flash_init();
-  }
-  nvsOpen();
-  Serial.println("[NVS] NVS ready");
+  kvStore->begin();
+  catalogCache.begin(kvStore);
 }
 
 void clearNVS() {
-  nvsOpen();
-  Serial.println("[NVS] Clearing all NVS data...");
-  nvsErr = nvs_erase_all(nvsHandle);
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_erase_all failed: " + String(getNVSErrorString(nvsErr)));
-  } else {
-    // Commit to write changes to flash
-    nvsErr = nvs_commit(nvsHandle);
-    if (nvsErr != ESP_OK) {
-      Serial.println("[NVS] ERROR: nvs_commit failed: " + String(getNVSErrorString(nvsErr)));
-    } else {
-      Serial.println("[NVS] NVS cleared and committed successfully");
-    }
-  }
-  
+  kvStore->eraseAll();
+  catalogCache.clear();
+}
+
+// Drops the in-memory lists, called by the UI alongside clearNVS()
+void resetCatalog() {
   routes.clear();
   trips.clear();
   stations.clear();
@@ -83,355 +48,299 @@ void clearNVS() {
   currentRouteIndex = 0;
   currentTripIndex = 0;
   currentStationIndex = 0;
+  watchlist.clear();  // its NVS copy goes with the rest
+  selectedTripId[0] = '\0';
+  selectedRouteName[0] = '\0';
   
-  Serial.println("[NVS] NVS cleared and all data reset!");
+  Serial.println("[NVS] All data reset!");
 }
 
-void saveRoutesToNVS() {
-  nvsOpen();
-  Serial.println("[NVS] Saving routes to NVS...");
-  
-  JsonDocument doc;
-  JsonArray array = doc.to<JsonArray>();
-  
-  for (const Route &r : routes) {
-    JsonObject obj = array.add<JsonObject>();
-    obj["route_id"] = r.route_id;
-    obj["route_short_name"] = r.route_short_name;
-    obj["route_long_name"] = r.route_long_name;
-    obj["route_type"] = r.route_type;
-    obj["hasVehicle"] = r.hasVehicle;
+// Decodes a blob, returns false if it is neither a current binary cache nor
+// a version 1 JSON cache that the caller can migrate
+static bool decodeBlob(const std::vector<uint8_t> &blob, CacheView &view, bool &legacy) {
+  CacheStatus status = cacheDecode(blob, view);
+  legacy = (status == CACHE_LEGACY_JSON);
+
+  if (status != CACHE_OK && !legacy) {
+    Serial.println("[NVS] ERROR: cache blob rejected: " + String(cacheStatusString(status)));
+    return false;
   }
-  
-  String json;
-  serializeJson(doc, json);
-  
-  Serial.println("[NVS] Routes JSON size: " + String(json.length()) + " bytes");
-  
-  // Use putBytes with direct NVS API
-  size_t written = 0;
-  const char* jsonData = json.c_str();
-  size_t jsonLen = json.length();
-  
-  nvsErr = nvs_set_blob(nvsHandle, "routes", (const void*)jsonData, jsonLen);
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_set_blob failed: " + String(getNVSErrorString(nvsErr)));
+  return true;
+}
+
+// Validators are stored next to each cache blob as "e_<blob key>"
+static String etagKey(const String &key) {
+  return "e_" + key;
+}
+
+static String loadETagFromNVS(const String &key) {
+  String etag;
+  return kvStore->getString(etagKey(key).c_str(), etag) ? etag : String("");
+}
+
+static void saveETagToNVS(const String &key, const String &etag) {
+  String ekey = etagKey(key);
+  if (etag.length() == 0) {
+    kvStore->erase(ekey.c_str());
   } else {
-    Serial.println("[NVS] nvs_set_blob succeeded, committing to flash...");
-    nvsErr = nvs_commit(nvsHandle);
-    
-    if (nvsErr != ESP_OK) {
-      Serial.println("[NVS] ERROR: nvs_commit failed: " + String(getNVSErrorString(nvsErr)));
-    } else {
-      Serial.println("[NVS] Successfully saved " + String(routes.size()) + " routes to NVS");
-      written = jsonLen;
-    }
+    kvStore->setString(ekey.c_str(), etag);
   }
-  
-  if (written == 0) {
-    Serial.println("[NVS] WARNING: Write returned 0 bytes");
+}
+
+// Caches from before validators, or whose validator was evicted, send none
+static void setIfNoneMatch(const String &key) {
+  String etag = loadETagFromNVS(key);
+  if (etag.length() > 0) {
+    netSetHeader("If-None-Match", etag);
   }
 }
 
-bool loadRoutesFromNVS() {
-  nvsOpen();
-  Serial.println("[NVS] Attempting to load routes from NVS...");
-  
-  size_t required_size = 0;
-  nvsErr = nvs_get_blob(nvsHandle, "routes", NULL, &required_size);
-  
-  if (nvsErr == ESP_ERR_NVS_NOT_FOUND) {
-    Serial.println("[NVS] No routes in NVS");
-    return false;
+// Totals of the cached first pages are stored as "n_<blob key>"
+static int loadTotalFromNVS(const String &key, int fallback) {
+  uint32_t total = 0;
+  if (!kvStore->getU32(("n_" + key).c_str(), total)) {
+    return fallback;  // cached before paging, the blob holds the whole list
   }
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_get_blob (size check) failed: " + String(getNVSErrorString(nvsErr)));
-    return false;
+  return total;
+}
+
+static void saveTotalToNVS(const String &key, int total) {
+  kvStore->setU32(("n_" + key).c_str(), total);
+}
+
+static String pageQuery(int offset) {
+  return "offset=" + String(offset) + "&limit=" + String(LIST_PAGE_SIZE);
+}
+
+// Size of the whole list from X-Total-Count, a server without paging sends none
+static int responseTotal(int fallback) {
+  String header = http.header("X-Total-Count");
+  return header.length() > 0 ? header.toInt() : fallback;
+}
+
+// A cache written before paging holds the whole list, keep the first page
+template <typename T>
+static void trimToPage(ListPage<T> &page) {
+  if (page.items.size() > LIST_PAGE_SIZE) {
+    page.items.resize(LIST_PAGE_SIZE);
   }
-  
-  Serial.println("[NVS] Routes blob size: " + String(required_size) + " bytes");
-  
-  std::vector<char> buf(required_size + 1);
-  nvsErr = nvs_get_blob(nvsHandle, "routes", buf.data(), &required_size);
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_get_blob (read) failed: " + String(getNVSErrorString(nvsErr)));
-    return false;
+}
+
+// Ends a page load. When the cached page was already posted an empty page
+// carrying the total tells the UI the load is over, otherwise the error is
+// reported.
+static void postFetchEnd(NetResult &result, bool cached, int total, const String &error) {
+  if (!cached) {
+    postNetError(result.seq, error);
+    return;
   }
-  
-  buf[required_size] = '\0';
-  String json(buf.data());
-  Serial.println("[NVS] Routes JSON loaded: " + String(json.length()) + " chars");
-  
+
+  result.fromCache = false;
+  result.total = total;
+  if (result.type == RESULT_ROUTES) {
+    result.routes = new ListPage<Route>();
+  } else if (result.type == RESULT_TRIPS) {
+    result.trips = new ListPage<Trip>();
+  } else {
+    result.stations = new ListPage<Station>();
+  }
+  postNetResult(result);
+}
+
+void saveRoutesToNVS(const std::vector<Route> &list) {
+  diagSample(DIAG_SAVE_ROUTES, DIAG_BEGIN);
+  Serial.println("[NVS] Saving routes to NVS...");
+
+  std::vector<uint8_t> blob;
+  encodeRoutes(list, blob);
+
+  Serial.println("[NVS] Routes blob size: " + String(blob.size()) + " bytes");
+
+  if (catalogCache.put("routes", blob)) {
+    Serial.println("[NVS] Successfully saved " + String(list.size()) + " routes to NVS");
+  } else {
+    Serial.println("[NVS] WARNING: Routes were not saved");
+  }
+  diagSample(DIAG_SAVE_ROUTES, DIAG_END);
+}
+
+// Version 1 caches were JSON arrays, parsed once and rewritten as binary
+static bool parseLegacyRoutes(const std::vector<uint8_t> &blob, ListPage<Route> &page) {
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, json);
-  
+  DeserializationError error = deserializeJson(doc, (const char*)blob.data(), blob.size());
+
   if (error) {
     Serial.println("[NVS] ERROR: JSON parse failed: " + String(error.c_str()));
     return false;
   }
-  
-  routes.clear();
-  JsonArray array = doc.as<JsonArray>();
-  
-  for (JsonObject obj : array) {
-    Route r;
-    r.route_id = obj["route_id"];
-    r.route_short_name = obj["route_short_name"].as<String>();
-    r.route_long_name = obj["route_long_name"].as<String>();
-    r.route_type = obj["route_type"] | 0;
-    r.hasVehicle = obj["hasVehicle"] | 0;
-    routes.push_back(r);
+
+  page.items.clear();
+  for (JsonObject obj : doc.as<JsonArray>()) {
+    appendRoute(page, obj);
   }
-  
-  routesLoaded = true;
-  Serial.println("[NVS] Successfully loaded " + String(routes.size()) + " routes from NVS");
   return true;
 }
 
-void saveTripsToNVS(int routeId) {
-  nvsOpen();
-  Serial.println("[NVS] Saving trips for route " + String(routeId) + "...");
-  
-  JsonDocument doc;
-  JsonArray array = doc.to<JsonArray>();
-  
-  for (const Trip &t : trips) {
-    JsonObject obj = array.add<JsonObject>();
-    obj["trip_id"] = t.trip_id;
-    obj["route_id"] = t.route_id;
-    obj["direction_id"] = t.direction_id;
-    obj["trip_headsign"] = t.trip_headsign;
+bool loadRoutesFromNVS(ListPage<Route> &page) {
+  Serial.println("[NVS] Attempting to load routes from NVS...");
+
+  std::vector<uint8_t> blob;
+  if (!catalogCache.get("routes", blob)) {
+    Serial.println("[NVS] No routes in NVS");
+    return false;
   }
-  
-  String json;
-  serializeJson(doc, json);
-  String key = "trips_" + String(routeId);
-  
-  Serial.println("[NVS] Trips JSON size: " + String(json.length()) + " bytes, key: " + key);
-  
-  nvsErr = nvs_set_blob(nvsHandle, key.c_str(), (const void*)json.c_str(), json.length());
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_set_blob failed: " + String(getNVSErrorString(nvsErr)));
-  } else {
-    Serial.println("[NVS] nvs_set_blob succeeded, committing...");
-    nvsErr = nvs_commit(nvsHandle);
-    
-    if (nvsErr != ESP_OK) {
-      Serial.println("[NVS] ERROR: nvs_commit failed: " + String(getNVSErrorString(nvsErr)));
-    } else {
-      Serial.println("[NVS] Successfully saved " + String(trips.size()) + " trips for route " + String(routeId));
+
+  CacheView view;
+  bool legacy = false;
+  if (!decodeBlob(blob, view, legacy)) {
+    return false;
+  }
+
+  if (legacy) {
+    Serial.println("[NVS] Migrating JSON routes cache to binary format");
+    if (!parseLegacyRoutes(blob, page)) {
+      return false;
     }
+    saveRoutesToNVS(page.items);
+  } else {
+    decodeRoutes(view, page);
   }
+
+  Serial.println("[NVS] Successfully loaded " + String(page.items.size()) + " routes from NVS");
+  return true;
 }
 
-bool loadTripsFromNVS(int routeId) {
-  nvsOpen();
+void saveTripsToNVS(int routeId, const std::vector<Trip> &list) {
+  diagSample(DIAG_SAVE_TRIPS, DIAG_BEGIN);
+  Serial.println("[NVS] Saving trips for route " + String(routeId) + "...");
+
+  std::vector<uint8_t> blob;
+  encodeTrips(list, blob);
   String key = "trips_" + String(routeId);
-  Serial.println("[NVS] Attempting to load trips for route " + String(routeId) + "...");
-  
-  size_t required_size = 0;
-  nvsErr = nvs_get_blob(nvsHandle, key.c_str(), NULL, &required_size);
-  
-  if (nvsErr == ESP_ERR_NVS_NOT_FOUND) {
-    Serial.println("[NVS] No trips for route " + String(routeId) + " in NVS");
-    return false;
-  }
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_get_blob (size check) failed: " + String(getNVSErrorString(nvsErr)));
-    return false;
-  }
-  
-  Serial.println("[NVS] Trips blob size: " + String(required_size) + " bytes");
-  
-  std::vector<char> buf(required_size + 1);
-  nvsErr = nvs_get_blob(nvsHandle, key.c_str(), buf.data(), &required_size);
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_get_blob (read) failed: " + String(getNVSErrorString(nvsErr)));
-    return false;
+
+  Serial.println("[NVS] Trips blob size: " + String(blob.size()) + " bytes, key: " + key);
+
+  if (catalogCache.put(key.c_str(), blob)) {
+    Serial.println("[NVS] Successfully saved " + String(list.size()) + " trips for route " + String(routeId));
   }
-  
-  buf[required_size] = '\0';
-  String json(buf.data());
-  
+  diagSample(DIAG_SAVE_TRIPS, DIAG_END);
+}
+
+static bool parseLegacyTrips(const std::vector<uint8_t> &blob, int routeId, ListPage<Trip> &page) {
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, json);
-  
+  DeserializationError error = deserializeJson(doc, (const char*)blob.data(), blob.size());
+
   if (error) {
     Serial.println("[NVS] ERROR: JSON parse failed for trips: " + String(error.c_str()));
     return false;
   }
-  
-  trips.clear();
-  JsonArray array = doc.as<JsonArray>();
-  
-  for (JsonObject obj : array) {
-    Trip t;
-    t.trip_id = obj["trip_id"].as<String>();
-    t.route_id = obj["route_id"] | routeId;
-    t.direction_id = obj["direction_id"] | 0;
-    t.trip_headsign = obj["trip_headsign"].as<String>();
-    trips.push_back(t);
+
+  page.items.clear();
+  for (JsonObject obj : doc.as<JsonArray>()) {
+    appendTrip(page, obj, routeId);
   }
-  
-  tripsLoaded = true;
-  Serial.println("[NVS] Successfully loaded " + String(trips.size()) + " trips for route " + String(routeId));
   return true;
 }
 
-void saveStationsToNVS() {
-  nvsOpen();
-  Serial.println("[NVS] Saving stations to NVS...");
-  
-  JsonDocument doc;
-  JsonArray array = doc.to<JsonArray>();
-  
-  for (const Station &s : stations) {
-    JsonObject obj = array.add<JsonObject>();
-    obj["sequence"] = s.sequence;
-    obj["name"] = s.name;
-    obj["lat"] = s.lat;
-    obj["lon"] = s.lon;
-    obj["hasVehicle"] = s.hasVehicle;
+bool loadTripsFromNVS(int routeId, ListPage<Trip> &page) {
+  String key = "trips_" + String(routeId);
+  Serial.println("[NVS] Attempting to load trips for route " + String(routeId) + "...");
+
+  std::vector<uint8_t> blob;
+  if (!catalogCache.get(key.c_str(), blob)) {
+    Serial.println("[NVS] No trips for route " + String(routeId) + " in NVS");
+    return false;
   }
-  
-  String json;
-  serializeJson(doc, json);
-  
-  Serial.println("[NVS] Stations JSON size: " + String(json.length()) + " bytes");
-  
-  nvsErr = nvs_set_blob(nvsHandle, "stations", (const void*)json.c_str(), json.length());
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_set_blob failed: " + String(getNVSErrorString(nvsErr)));
-  } else {
-    Serial.println("[NVS] nvs_set_blob succeeded, committing...");
-    nvsErr = nvs_commit(nvsHandle);
-    
-    if (nvsErr != ESP_OK) {
-      Serial.println("[NVS] ERROR: nvs_commit failed: " + String(getNVSErrorString(nvsErr)));
-    } else {
-      Serial.println("[NVS] Successfully saved " + String(stations.size()) + " stations to NVS");
+
+  CacheView view;
+  bool legacy = false;
+  if (!decodeBlob(blob, view, legacy)) {
+    return false;
+  }
+
+  if (legacy) {
+    Serial.println("[NVS] Migrating JSON trips cache to binary format");
+    if (!parseLegacyTrips(blob, routeId, page)) {
+      return false;
     }
+    saveTripsToNVS(routeId, page.items);
+  } else {
+    decodeTrips(view, page);
   }
+
+  Serial.println("[NVS] Successfully loaded " + String(page.items.size()) + " trips for route " + String(routeId));
+  return true;
 }
 
-bool loadStationsFromNVS() {
-  nvsOpen();
-  Serial.println("[NVS] Attempting to load stations from NVS...");
-  
-  size_t required_size = 0;
-  nvsErr = nvs_get_blob(nvsHandle, "stations", NULL, &required_size);
-  
-  if (nvsErr == ESP_ERR_NVS_NOT_FOUND) {
-    Serial.println("[NVS] No stations in NVS");
-    return false;
-  }
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_get_blob (size check) failed: " + String(getNVSErrorString(nvsErr)));
-    return false;
+// Stations are cached per trip as "st_<CRC32 of the trip id>", NVS keys are
+// at most 15 characters. The backend's selected trip keeps the old key.
+String stationsKey(const char *tripId) {
+  if (tripId[0] == '\0') {
+    return "stations";
   }
-  
-  Serial.println("[NVS] Stations blob size: " + String(required_size) + " bytes");
-  
-  std::vector<char> buf(required_size + 1);
-  nvsErr = nvs_get_blob(nvsHandle, "stations", buf.data(), &required_size);
-  
-  if (nvsErr != ESP_OK) {
-    Serial.println("[NVS] ERROR: nvs_get_blob (read) failed: " + String(getNVSErrorString(nvsErr)));
-    return false;
+  char key[12];
+  snprintf(key, sizeof(key), "st_%08lx", (unsigned long)cacheCrc32((const uint8_t *)tripId, strlen(tripId)));
+  return key;
+}
+
+void saveStationsToNVS(const String &key, const std::vector<Station> &list) {
+  diagSample(DIAG_SAVE_STATIONS, DIAG_BEGIN);
+  Serial.println("[NVS] Saving stations to NVS, key: " + key);
+
+  std::vector<uint8_t> blob;
+  encodeStations(list, blob);
+
+  Serial.println("[NVS] Stations blob size: " + String(blob.size()) + " bytes");
+
+  if (catalogCache.put(key.c_str(), blob)) {
+    Serial.println("[NVS] Successfully saved " + String(list.size()) + " stations to NVS");
   }
-  
-  buf[required_size] = '\0';
-  String json(buf.data());
-  
+  diagSample(DIAG_SAVE_STATIONS, DIAG_END);
+}
+
+static bool parseLegacyStations(const std::vector<uint8_t> &blob, ListPage<Station> &page) {
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, json);
-  
+  DeserializationError error = deserializeJson(doc, (const char*)blob.data(), blob.size());
+
   if (error) {
     Serial.println("[NVS] ERROR: JSON parse failed for stations: " + String(error.c_str()));
     return false;
   }
-  
-  stations.clear();
-  JsonArray array = doc.as<JsonArray>();
-  
-  for (JsonObject obj : array) {
-    Station s;
-    s.sequence = obj["sequence"];
-    s.name = obj["name"].as<String>();
-    s.lat = obj["lat"];
-    s.lon = obj["lon"];
-    s.hasVehicle = obj["hasVehicle"];
-    stations.push_back(s);
+
+  page.items.clear();
+  for (JsonObject obj : doc.as<JsonArray>()) {
+    appendStation(page, obj, "name");
   }
-  
-  stationsLoaded = true;
-  Serial.println("[NVS] Successfully loaded " + String(stations.size()) + " stations from NVS");
   return true;
 }
 
-void showMessage(const String &text, uint16_t color, int textSize, int y) {
-  gfx->fillScreen(BLACK);
-  gfx->setTextSize(textSize);
-  gfx->setTextColor(color);
-  gfx->setCursor(10, y);
-  gfx->println(text);
-}
-
-void displayWrappedText(const String &text, int startY) {
-  gfx->setTextSize(1);
-  gfx->setTextColor(WHITE);
-
-  int y = startY;
-  String line = "";
-  const int maxCharsPerLine = 50;
+bool loadStationsFromNVS(const String &key, ListPage<Station> &page) {
+  Serial.println("[NVS] Attempting to load stations from NVS, key: " + key);
 
-  for (unsigned int i = 0; i < text.length() && y < gfx->height() - 20; i++) {
-    char c = text[i];
+  std::vector<uint8_t> blob;
+  if (!catalogCache.get(key.c_str(), blob)) {
+    Serial.println("[NVS] No stations in NVS");
+    return false;
+  }
 
-    if (c == '\n' || line.length() >= maxCharsPerLine) {
-      gfx->setCursor(10, y);
-      gfx->println(line);
-      y += 12;
-      line = (c == '\n') ? "" : String(c);
-    } else {
-      line += c;
-    }
+  CacheView view;
+  bool legacy = false;
+  if (!decodeBlob(blob, view, legacy)) {
+    return false;
   }
 
-  if (line.length() > 0 && y < gfx->height() - 20) {
-    gfx->setCursor(10, y);
-    gfx->println(line);
+  if (legacy) {
+    Serial.println("[NVS] Migrating JSON stations cache to binary format");
+    if (!parseLegacyStations(blob, page)) {
+      return false;
+    }
+    saveStationsToNVS(key, page.items);
+  } else {
+    decodeStations(view, page);
   }
-}
 
-void drawClearPopup(unsigned long remainingMs) {
-  int W = gfx->width();
-  int H = gfx->height();
-  int boxW = (W * 2) / 3;
-  int boxH = 50;
-  int boxX = (W - boxW) / 2;
-  int boxY = (H - boxH) / 2;
-  
-  gfx->fillRoundRect(boxX, boxY, boxW, boxH, 6, RED);
-  gfx->drawRoundRect(boxX, boxY, boxW, boxH, 6, WHITE);
-  gfx->setTextColor(WHITE);
-  gfx->setTextSize(2);
-  
-  char buf[32];
-  unsigned long seconds = (remainingMs + 999) / 1000;
-  snprintf(buf, sizeof(buf), "Hold %lus more", (unsigned long)seconds);
-  
-  int textX = boxX + (boxW - strlen(buf) * 12) / 2;
-  gfx->setCursor(textX, boxY + (boxH / 2) - 8);
-  gfx->println(buf);
+  Serial.println("[NVS] Successfully loaded " + String(page.items.size()) + " stations from NVS");
+  return true;
 }
 
 void initDisplay() {
@@ -440,344 +349,661 @@ void initDisplay() {
   pinMode(PIN_BACKLIGHT, OUTPUT);
   digitalWrite(PIN_BACKLIGHT, HIGH);
 
-  gfx->begin();
-  gfx->setRotation(3);
+  // Canvas begin() also starts the panel
+  if (!gfx->begin()) {
+    Serial.println("[DISPLAY] Canvas allocation failed, drawing directly to the panel");
+    gfx = panel;
+    gfx->begin();
+  }
+  panel->setRotation(3);
+  panel->fillScreen(BLACK);
   gfx->fillScreen(BLACK);
 }
 
-void loadRoutes() {
-  if (loadRoutesFromNVS()) {
-    displayCurrentRoute();
-    return;
-  }
+// Turns the panel and its supply off before deep sleep
+void displayPowerDown() {
+  panel->displayOff();
+  digitalWrite(PIN_BACKLIGHT, LOW);
+  digitalWrite(PIN_POWER, LOW);
+}
 
-  showMessage("Loading routes...", YELLOW);
+// Queues a routes load, the result arrives in the UI loop as RESULT_ROUTES
+void loadRoutes() {
+  deferUi(LOADING_MESSAGE_DELAY, []() { showMessage("Loading routes...", YELLOW); });
 
-  WiFiClientSecure *client = new WiFiClientSecure;
-  client->setInsecure();
-  HTTPClient http;
+  NetRequest request = {};
+  request.type = NET_LOAD_ROUTES;
+  request.offset = listPageOffset(currentRouteIndex);
+  uiAwaitingSeq = postNetRequest(request);
+}
 
-  String url = String(serverUrl) + "/api/routes-with-vehicles";
+// Network task: loads the page at offset. For the first page the cached
+// copy is posted straight away, then revalidated with the server. A 304
+// keeps the cached page without transferring or parsing a body, a 200 posts
+// the fresh page as a second result.
+void fetchRoutes(uint32_t seq, int offset) {
+  NetResult result = {};
+  result.type = RESULT_ROUTES;
+  result.seq = seq;
+  result.offset = offset;
+
+  // Only the first page is cached, it is what boot and wrap-around show
+  bool cached = false;
+  int cachedTotal = 0;
+  if (offset == 0) {
+    ListPage<Route> *cachedList = new ListPage<Route>();
+    cached = loadRoutesFromNVS(*cachedList);
+    if (cached) {
+      cachedTotal = loadTotalFromNVS("routes", cachedList->items.size());
+      trimToPage(*cachedList);
+      result.routes = cachedList;
+      result.total = cachedTotal;
+      result.fromCache = true;
+      postNetResult(result);
+    } else {
+      delete cachedList;
+    }
+  }
 
-  if (!http.begin(*client, url)) {
-    showMessage("Connection failed", RED);
-    delete client;
+  if (!netBegin("/api/routes-with-vehicles?" + pageQuery(offset))) {
+    postFetchEnd(result, cached, cachedTotal, "Connection failed");
     return;
   }
 
-  int httpCode = http.GET();
+  if (cached) {
+    setIfNoneMatch("routes");
+  }
+  int httpCode = netGet();
 
-  if (httpCode == HTTP_CODE_OK) {
-    String payload = http.getString();
-    Serial.println("Routes JSON: " + payload);
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+    Serial.println("Routes cache is up to date");
+    int total = responseTotal(cachedTotal);
+    if (total != cachedTotal) saveTotalToNVS("routes", total);
+    postFetchEnd(result, cached, total, "");
+  } else if (httpCode == HTTP_CODE_OK) {
+    JsonDocument filter;
+    routeFilter(filter);
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    ListPage<Route> *parsed = new ListPage<Route>();
+    DeserializationError error = netParseArray(filter, [parsed](JsonObject obj) {
+      appendRoute(*parsed, obj);
+    });
 
     if (error) {
-      showMessage("JSON parse error", RED);
+      delete parsed;
       Serial.println("JSON Error: " + String(error.c_str()));
+      postFetchEnd(result, cached, cachedTotal, "JSON parse error");
     } else {
-      routes.clear();
-      trips.clear();
-      stations.clear();
-      tripsLoaded = false;
-      stationsLoaded = false;
-      currentTripIndex = 0;
-      currentStationIndex = 0;
-
-      JsonArray array = doc.as<JsonArray>();
-
-      for (JsonObject obj : array) {
-        Route r;
-        r.route_id = obj["route_id"];
-        r.route_short_name = obj["route_short_name"].as<String>();
-        r.route_long_name = obj["route_long_name"].as<String>();
-        r.route_type = obj["route_type"] | 0;
-        r.hasVehicle = obj["hasVehicle"] | 0;
-        routes.push_back(r);
+      int total = responseTotal(offset + parsed->items.size());
+      Serial.println("Loaded " + String(parsed->items.size()) + " of " + String(total) + " routes from API");
+      if (offset == 0) {
+        saveRoutesToNVS(parsed->items);
+        saveETagToNVS("routes", http.header("ETag"));
+        saveTotalToNVS("routes", total);
       }
 
-      routesLoaded = true;
-      currentRouteIndex = 0;
-      currentScreen = SCREEN_ROUTES;
-      Serial.println("Loaded " + String(routes.size()) + " routes from API");
-      saveRoutesToNVS();
-      displayCurrentRoute();
+      result.routes = parsed;
+      result.total = total;
+      result.fromCache = false;
+      postNetResult(result);
     }
   } else {
-    showMessage("HTTP Error: " + String(httpCode), RED);
+    postFetchEnd(result, cached, cachedTotal, "HTTP Error: " + String(httpCode));
   }
 
-  http.end();
-  delete client;
+  netEnd();
 }
 
-void displayCurrentRoute() {
-  if (!routesLoaded || routes.empty()) {
-    showMessage("No routes loaded", RED);
-    return;
-  }
-
-  Route &route = routes[currentRouteIndex];
-  currentScreen = SCREEN_ROUTES;
-
-  gfx->fillScreen(BLACK);
-
-  gfx->setTextSize(2);
-  gfx->setTextColor(CYAN);
-  gfx->setCursor(10, 10);
-  gfx->printf("%d/%d", currentRouteIndex + 1, (int)routes.size());
-
-  gfx->setTextSize(2);
-  gfx->setTextColor(WHITE);
-  gfx->setCursor(10, 40);
-  gfx->println(route.route_short_name + " -");
+void loadTripsForRoute(int routeId) {
+  deferUi(LOADING_MESSAGE_DELAY, []() { showMessage("Loading trips...", YELLOW); });
 
-  gfx->setTextSize(1);
-  gfx->setTextColor(WHITE);
-  gfx->setCursor(10, 65);
-  displayWrappedText(route.route_long_name, 65);
+  // Another route's trips start over at the first one
+  if (trips.owner != routeId) {
+    currentTripIndex = 0;
+  }
 
-  gfx->setTextSize(1);
-  gfx->setTextColor(YELLOW);
-  gfx->setCursor(10, 155);
-  gfx->println("BTN1: Next  BTN2: Select");
+  NetRequest request = {};
+  request.type = NET_LOAD_TRIPS;
+  request.routeId = routeId;
+  request.offset = listPageOffset(currentTripIndex);
+  uiAwaitingSeq = postNetRequest(request);
 }
 
-void loadTripsForRoute(int routeId) {
-  if (loadTripsFromNVS(routeId)) {
-    displayCurrentTrip();
-    return;
+void fetchTrips(uint32_t seq, int routeId, int offset) {
+  String key = "trips_" + String(routeId);
+  NetResult result = {};
+  result.type = RESULT_TRIPS;
+  result.seq = seq;
+  result.routeId = routeId;
+  result.offset = offset;
+
+  bool cached = false;
+  int cachedTotal = 0;
+  if (offset == 0) {
+    ListPage<Trip> *cachedList = new ListPage<Trip>();
+    cached = loadTripsFromNVS(routeId, *cachedList);
+    if (cached) {
+      cachedTotal = loadTotalFromNVS(key, cachedList->items.size());
+      trimToPage(*cachedList);
+      result.trips = cachedList;
+      result.total = cachedTotal;
+      result.fromCache = true;
+      postNetResult(result);
+    } else {
+      delete cachedList;
+    }
   }
 
-  showMessage("Loading trips...", YELLOW);
-
-  WiFiClientSecure *client = new WiFiClientSecure;
-  client->setInsecure();
-  HTTPClient http;
-
-  String url = String(serverUrl) + "/api/trips?routeId=" + String(routeId);
-
-  if (!http.begin(*client, url)) {
-    showMessage("Connection failed", RED);
-    delete client;
+  if (!netBegin("/api/trips?routeId=" + String(routeId) + "&" + pageQuery(offset))) {
+    postFetchEnd(result, cached, cachedTotal, "Connection failed");
     return;
   }
 
-  int httpCode = http.GET();
+  if (cached) {
+    setIfNoneMatch(key);
+  }
+  int httpCode = netGet();
 
-  if (httpCode == HTTP_CODE_OK) {
-    String payload = http.getString();
-    Serial.println("Trips JSON: " + payload);
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+    Serial.println("Trips cache for route " + String(routeId) + " is up to date");
+    int total = responseTotal(cachedTotal);
+    if (total != cachedTotal) saveTotalToNVS(key, total);
+    postFetchEnd(result, cached, total, "");
+  } else if (httpCode == HTTP_CODE_OK) {
+    JsonDocument filter;
+    tripFilter(filter);
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    ListPage<Trip> *parsed = new ListPage<Trip>();
+    DeserializationError error = netParseArray(filter, [parsed, routeId](JsonObject obj) {
+      appendTrip(*parsed, obj, routeId);
+    });
 
     if (error) {
-      showMessage("JSON parse error", RED);
+      delete parsed;
       Serial.println("JSON Error: " + String(error.c_str()));
+      postFetchEnd(result, cached, cachedTotal, "JSON parse error");
     } else {
-      trips.clear();
-      stations.clear();
-      stationsLoaded = false;
-      currentTripIndex = 0;
-      currentStationIndex = 0;
-
-      JsonArray array = doc.as<JsonArray>();
-
-      for (JsonObject obj : array) {
-        Trip t;
-        t.trip_id = obj["trip_id"].as<String>();
-        t.route_id = obj["route_id"] | routeId;
-        t.direction_id = obj["direction_id"] | 0;
-        t.trip_headsign = obj["trip_headsign"].as<String>();
-        trips.push_back(t);
+      int total = responseTotal(offset + parsed->items.size());
+      Serial.println("Loaded " + String(parsed->items.size()) + " of " + String(total) + " trips from API");
+      if (offset == 0) {
+        saveTripsToNVS(routeId, parsed->items);
+        saveETagToNVS(key, http.header("ETag"));
+        saveTotalToNVS(key, total);
       }
 
-      tripsLoaded = true;
-      currentScreen = SCREEN_TRIPS;
-      Serial.println("Loaded " + String(trips.size()) + " trips from API");
-      saveTripsToNVS(routeId);
-      displayCurrentTrip();
+      result.trips = parsed;
+      result.total = total;
+      result.fromCache = false;
+      postNetResult(result);
     }
   } else {
-    showMessage("HTTP Error: " + String(httpCode), RED);
+    postFetchEnd(result, cached, cachedTotal, "HTTP Error: " + String(httpCode));
   }
 
-  http.end();
-  delete client;
+  netEnd();
 }
 
-void displayCurrentTrip() {
-  if (!tripsLoaded || trips.empty()) {
-    showMessage("No trips loaded", RED);
-    return;
+void loadStations() {
+  deferUi(LOADING_MESSAGE_DELAY, []() { showMessage("Loading stations...", YELLOW); });
+
+  NetRequest request = {};
+  request.type = NET_LOAD_STATIONS;
+  request.offset = listPageOffset(currentStationIndex);
+  strlcpy(request.tripId, selectedTripId, sizeof(request.tripId));
+  uiAwaitingSeq = postNetRequest(request);
+}
+
+// Keeps the page at offset of a list held whole
+template <typename T>
+static void keepPage(ListPage<T> &page, int offset) {
+  int from = std::min(offset, (int)page.items.size());
+  int to = std::min(from + LIST_PAGE_SIZE, (int)page.items.size());
+  page.items.erase(page.items.begin() + to, page.items.end());
+  page.items.erase(page.items.begin(), page.items.begin() + from);
+}
+
+// Trip station caches checked against the backend since boot. A trip's stops
+// only change with the timetable, so these are used without a request.
+// Network task only.
+static std::vector<String> revalidatedStations;
+
+static bool stationsRevalidated(const String &key) {
+  return std::find(revalidatedStations.begin(), revalidatedStations.end(), key) != revalidatedStations.end();
+}
+
+static void markStationsRevalidated(const char *tripId, const String &key) {
+  // The session's trip (no tripId) can change under the same key
+  if (tripId[0] == '\0' || stationsRevalidated(key)) return;
+  if (revalidatedStations.size() >= STATIONS_REVALIDATED_MAX) {
+    revalidatedStations.erase(revalidatedStations.begin());
   }
+  revalidatedStations.push_back(key);
+}
 
-  Trip &trip = trips[currentTripIndex];
-  currentScreen = SCREEN_TRIPS;
+// The trip's cached station list, false unless it holds the whole trip (a
+// cache from before per-trip lists may only hold the first page)
+static bool loadTripStationsFromNVS(const String &key, ListPage<Station> &page) {
+  return loadStationsFromNVS(key, page) && loadTotalFromNVS(key, page.items.size()) <= (int)page.items.size();
+}
 
-  gfx->fillScreen(BLACK);
+// Network task: the whole station list of tripId, saved under key. With
+// revalidate the cached list's ETag is sent along. Returns the HTTP code,
+// error is set whenever out was not filled and the code is not 304.
+static int fetchTripStations(const char *tripId, const String &key, bool revalidate, ListPage<Station> &out, String &error) {
+  String path = "/api/stations-with-vehicles";
+  if (tripId[0] != '\0') {
+    path += "?tripId=" + urlEncode(tripId);
+  }
+  if (!netBegin(path)) {
+    error = "Connection failed";
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
 
-  gfx->setTextSize(2);
-  gfx->setTextColor(CYAN);
-  gfx->setCursor(10, 10);
-  gfx->printf("%d/%d", currentTripIndex + 1, (int)trips.size());
+  if (revalidate) {
+    setIfNoneMatch(key);
+  }
+  int httpCode = netGet();
 
-  gfx->setTextSize(2);
-  gfx->setTextColor(WHITE);
-  gfx->setCursor(10, 40);
-  gfx->println("Trip");
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+    markStationsRevalidated(tripId, key);
+  } else if (httpCode == HTTP_CODE_OK) {
+    JsonDocument filter;
+    stationFilter(filter);
 
-  gfx->setTextSize(1);
-  gfx->setTextColor(WHITE);
-  gfx->setCursor(10, 65);
-  displayWrappedText(trip.trip_headsign, 65);
+    DeserializationError parseError = netParseArray(filter, [&out](JsonObject obj) {
+      appendStation(out, obj);
+    });
 
-  gfx->setTextSize(1);
-  gfx->setTextColor(YELLOW);
-  gfx->setCursor(10, 130);
-  gfx->println("Dir: " + String(trip.direction_id));
+    if (parseError) {
+      Serial.println("JSON Error: " + String(parseError.c_str()));
+      error = "JSON parse error";
+    } else {
+      saveStationsToNVS(key, out.items);
+      saveETagToNVS(key, http.header("ETag"));
+      saveTotalToNVS(key, out.items.size());
+      markStationsRevalidated(tripId, key);
+    }
+  } else {
+    if (httpCode > 0) http.getString();
+    error = "HTTP Error: " + String(httpCode);
+  }
 
-  gfx->setTextSize(1);
-  gfx->setTextColor(YELLOW);
-  gfx->setCursor(10, 145);
-  gfx->println("BTN1: Next  BTN2: Select");
-  gfx->setCursor(10, 158);
-  gfx->println("Hold BTN2: Routes");
+  netEnd();
+  return httpCode;
 }
 
-void loadStations() {
-  if (loadStationsFromNVS()) {
-    displayCurrentStation();
-    return;
+// A trip's stations are few, so they are fetched and cached whole under the
+// trip's own key and every page is cut from that list. Paging through a trip,
+// or coming back to one, is a local load, revalidated once per boot.
+void fetchStations(uint32_t seq, const char *tripId, int offset) {
+  NetResult result = {};
+  result.type = RESULT_STATIONS;
+  result.seq = seq;
+  result.offset = offset;
+  strlcpy(result.tripId, tripId, sizeof(result.tripId));
+  String key = stationsKey(tripId);
+
+  ListPage<Station> *cachedList = new ListPage<Station>();
+  bool cached = loadTripStationsFromNVS(key, *cachedList);
+  int cachedTotal = 0;
+  if (cached) {
+    bool revalidated = stationsRevalidated(key);
+    cachedTotal = cachedList->items.size();
+    keepPage(*cachedList, offset);
+    result.stations = cachedList;
+    result.total = cachedTotal;
+    result.fromCache = !revalidated;
+    postNetResult(result);
+    if (revalidated) {
+      Serial.println("Stations of trip " + String(tripId) + " served from NVS");
+      return;
+    }
+  } else {
+    delete cachedList;
+  }
+
+  ListPage<Station> *parsed = new ListPage<Station>();
+  String error;
+  int httpCode = fetchTripStations(tripId, key, cached, *parsed, error);
+
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+    delete parsed;
+    Serial.println("Stations cache is up to date");
+    postFetchEnd(result, cached, cachedTotal, "");
+  } else if (error.length() == 0) {
+    int total = parsed->items.size();
+    Serial.println("Loaded " + String(total) + " stations of trip " + String(tripId) + " from API");
+    keepPage(*parsed, offset);
+    result.stations = parsed;
+    result.total = total;
+    result.fromCache = false;
+    postNetResult(result);
+  } else {
+    delete parsed;
+    postFetchEnd(result, cached, cachedTotal, error);
   }
+}
 
-  showMessage("Loading stations...", YELLOW);
+// Network task, speculative: caches the first trips page of a route the
+// user rests on, for the SELECT that may follow. Nothing is fetched when it
+// is cached already. The results carry a seq the UI does not wait for, so
+// they are dropped and only the cache stays.
+void warmTrips(uint32_t seq, int routeId) {
+  String key = "trips_" + String(routeId);
+  if (catalogCache.contains(key.c_str())) return;
 
-  WiFiClientSecure *client = new WiFiClientSecure;
-  client->setInsecure();
-  HTTPClient http;
+  Serial.println("[WARM] Trips of route " + String(routeId));
+  fetchTrips(seq, routeId, 0);
+}
 
-  String url = String(serverUrl) + "/api/stations-with-vehicles";
+// Same for the stations of a trip, also when they are cached but were not
+// revalidated yet, so SELECT needs no request at all
+void warmStations(uint32_t seq, const char *tripId) {
+  if (tripId[0] == '\0' || stationsRevalidated(stationsKey(tripId))) return;
 
-  if (!http.begin(*client, url)) {
-    showMessage("Connection failed", RED);
-    delete client;
-    return;
+  Serial.println("[WARM] Stations of trip " + String(tripId));
+  fetchStations(seq, tripId, 0);
+}
+
+// Network task: fetches the compact status, returns the HTTP code. status is
+// left zeroed unless a valid payload arrived. retryAfterMs is set from the
+// server's Retry-After header (0 when there is none).
+int fetchStatus(CompactStatus &status, unsigned long &retryAfterMs) {
+  memset(&status, 0, sizeof(status));
+  retryAfterMs = 0;
+
+  if (!netBegin("/api/status/compact")) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
   }
 
-  int httpCode = http.GET();
+  int httpCode = netGet();
+
+  if (httpCode > 0) {
+    // Only the delta-seconds form, an HTTP date parses as 0 and is ignored
+    retryAfterMs = http.header("Retry-After").toInt() * 1000UL;
+  }
 
   if (httpCode == HTTP_CODE_OK) {
-    String payload = http.getString();
-    Serial.println("Stations JSON: " + payload);
+    uint8_t payload[sizeof(CompactStatus)];
+    size_t len = netStream().readBytes(payload, sizeof(payload));
+    if (decodeCompactStatus(payload, len, status)) {
+      Serial.println("Status: state " + String(status.state) + ", seq " + String(status.seq));
+    } else {
+      Serial.println("[STATUS] ERROR: Bad compact payload (" + String(len) + " bytes)");
+    }
+  } else if (httpCode > 0) {
+    http.getString();  // drain the error body, the socket is kept alive
+  }
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+  netEnd();
+  return httpCode;
+}
 
-    if (error) {
-      showMessage("JSON parse error", RED);
-      Serial.println("JSON Error: " + String(error.c_str()));
-    } else {
-      stations.clear();
-      JsonArray array = doc.as<JsonArray>();
-
-      for (JsonObject obj : array) {
-        Station s;
-        s.sequence = obj["sequence"];
-        s.name = obj["stationName"].as<String>();
-        s.lat = obj["lat"];
-        s.lon = obj["lon"];
-        s.hasVehicle = obj["hasVehicle"];
-        stations.push_back(s);
+// On-device status of each watched stop, network task state. A state
+// follows its stop when the watchlist is reordered, so the stops are loaded
+// and the vehicles tracked once per stop, not once per position in the list.
+struct WatchState {
+  Watch watch;          // empty tripId for an unused slot
+  bool loaded;          // stops are in, the status can be computed here
+  TripStops stops;
+  int userStop;
+  VehicleTracker tracker;
+  CompactStatus last;   // last computed, for seq
+  uint8_t failures;     // stop loads failed in a row
+  unsigned long retryAt;  // no new load before this while failures > 0
+};
+
+static WatchState watchStates[WATCH_MAX];
+// The backend had no (current) vehicle feed, its statuses are used until
+// feedRetryAt. A 404 may only be a cold start or a deploy, so it is asked
+// again with a backoff like the status poll's.
+static uint8_t feedMissingCount = 0;
+static unsigned long feedRetryAt = 0;
+
+static bool vehicleFeedMissing() {
+  return feedMissingCount > 0 && (long)(millis() - feedRetryAt) < 0;
+}
+
+static void markFeedMissing() {
+  if (feedMissingCount < 255) feedMissingCount++;
+  int shift = min(feedMissingCount - 1, 16);
+  unsigned long delayMs = min((unsigned long)FEED_RETRY_BASE_MS << shift, (unsigned long)FEED_RETRY_MAX_MS);
+  delayMs = delayMs / 2 + random(delayMs / 2 + 1);
+  feedRetryAt = millis() + delayMs;
+  Serial.println("[STATUS] Vehicle feed asked for again in " + String(delayMs / 1000) + " s");
+}
+
+static void resetWatchState(WatchState &state, const Watch &watch) {
+  state.watch = watch;
+  state.loaded = false;
+  state.stops.clear();
+  state.userStop = -1;
+  state.tracker.clear();
+  memset(&state.last, 0, sizeof(state.last));
+  state.failures = 0;
+  state.retryAt = 0;
+}
+
+// Lines watchStates up with the watchlist, slot i for watch i
+static void syncWatchStates(const Watchlist &watches) {
+  for (int i = 0; i < watches.count(); i++) {
+    int found = -1;
+    for (int j = i; j < WATCH_MAX && found < 0; j++) {
+      if (sameWatch(watchStates[j].watch, watches[i])) found = j;
+    }
+
+    if (found < 0) {
+      // A slot no later watch still needs, there always is one
+      for (int j = i; j < WATCH_MAX && found < 0; j++) {
+        if (watchStates[j].watch.tripId[0] == '\0' || watches.find(watchStates[j].watch) < i) found = j;
       }
+      resetWatchState(watchStates[found], watches[i]);
+    }
 
-      stationsLoaded = true;
-      currentStationIndex = 0;
-      currentScreen = SCREEN_STATIONS;
-      Serial.println("Loaded " + String(stations.size()) + " stations from API");
-      saveStationsToNVS();
-      displayCurrentStation();
+    if (found != i) {
+      std::swap(watchStates[i], watchStates[found]);
     }
-  } else {
-    showMessage("HTTP Error: " + String(httpCode), RED);
   }
 
-  http.end();
-  delete client;
+  for (int i = watches.count(); i < WATCH_MAX; i++) {
+    if (watchStates[i].watch.tripId[0] != '\0') {
+      resetWatchState(watchStates[i], Watch());
+    }
+  }
 }
 
-void displayCurrentStation() {
+// A failed load waits like a failed status poll, doubling with equal jitter.
+// The backend's statuses cover the watch meanwhile.
+static void watchStopsFailed(WatchState &state) {
+  if (state.failures < 255) state.failures++;
+  int shift = min(state.failures - 1, 16);
+  unsigned long delayMs = min((unsigned long)STATUS_BACKOFF_BASE_MS << shift, (unsigned long)STATUS_BACKOFF_MAX_MS);
+  delayMs = delayMs / 2 + random(delayMs / 2 + 1);
+  state.retryAt = millis() + delayMs;
+  Serial.println("[STATUS] Trip stops for " + String(state.watch.tripId) + " retried in " + String(delayMs / 1000) + " s");
+}
 
-  if (!stationsLoaded || stations.empty()) {
-    showMessage("No stations loaded", RED);
-    return;
+// Network task: loads the stops of the watch's trip, once per watch. They
+// come from the trip's station cache, fetched (and cached) only when missing.
+static bool loadWatchStops(WatchState &state) {
+  if (state.failures > 0 && (long)(millis() - state.retryAt) < 0) {
+    return false;
   }
 
-  Station &station = stations[currentStationIndex];
-  currentScreen = SCREEN_STATIONS;
+  String key = stationsKey(state.watch.tripId);
+  ListPage<Station> list;
+  if (!loadTripStationsFromNVS(key, list)) {
+    list.items.clear();
+    String error;
+    fetchTripStations(state.watch.tripId, key, false, list, error);
+    if (error.length() > 0) {
+      Serial.println("[STATUS] Trip stops not loaded: " + error);
+      watchStopsFailed(state);
+      return false;
+    }
+  }
 
-  gfx->fillScreen(BLACK);
+  std::vector<StopPoint> points;
+  points.reserve(list.items.size());
+  for (const Station &station : list.items) {
+    points.push_back({station.sequence, (float)station.lat, (float)station.lon});
+  }
+
+  if (!points.empty()) {
+    state.stops.assign(points);
+    state.userStop = state.stops.nearest(state.watch.lat, state.watch.lon);
+    state.loaded = true;
+    state.failures = 0;
+    Serial.println("[STATUS] " + String(state.stops.size()) + " stops loaded for trip " + String(state.watch.tripId));
+  } else {
+    watchStopsFailed(state);
+  }
+  return state.loaded;
+}
+
+// Network task: the backend works out every watch's status, one request for
+// all of them. A backend from before the watchlist answers 404 and only knows
+// the stop that was selected last, which is the first watch.
+static int fetchStatusBatch(const Watchlist &watches, StatusBatch &out, unsigned long &retryAfterMs) {
+  String path = "/api/status/batch?";
+  for (int i = 0; i < watches.count(); i++) {
+    const Watch &watch = watches[i];
+    if (i > 0) path += "&";
+    path += "watch=" + urlEncode(watch.tripId) + "," + String(watch.lat, 6) + "," + String(watch.lon, 6);
+  }
 
-  gfx->setTextSize(2);
-  gfx->setTextColor(CYAN);
-  gfx->setCursor(10, 10);
-  gfx->printf("%d/%d", station.sequence, (int)stations.size());
-
-  gfx->setTextSize(2);
-  gfx->setTextColor(WHITE);
-  gfx->setCursor(10, 40);
-
-  String name = station.name;
-  if (name.length() > 18) {
-    int spacePos = name.lastIndexOf(' ', 18);
-    if (spacePos > 0) {
-      gfx->println(name.substring(0, spacePos));
-      gfx->setCursor(10, 60);
-      gfx->println(name.substring(spacePos + 1));
+  if (!netBegin(path)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+
+  int httpCode = netGet();
+
+  if (httpCode > 0) {
+    retryAfterMs = http.header("Retry-After").toInt() * 1000UL;
+  }
+
+  if (httpCode == HTTP_CODE_OK) {
+    static uint8_t payload[STATUS_BATCH_HEADER_SIZE + STATUS_BATCH_MAX * sizeof(CompactStatus)];
+    size_t len = netReadBody(payload, sizeof(payload));
+    if (decodeStatusBatch(payload, len, out)) {
+      Serial.println("Status: " + String(out.count) + " stops from the backend");
     } else {
-      gfx->println(name.substring(0, 18));
-      gfx->setCursor(10, 60);
-      gfx->println(name.substring(18));
+      Serial.println("[STATUS] ERROR: Bad status batch (" + String(len) + " bytes)");
     }
-  } else {
-    gfx->println(name);
+  } else if (httpCode > 0) {
+    http.getString();
   }
 
-  gfx->setTextSize(1);
-  gfx->setTextColor(YELLOW);
-  gfx->setCursor(10, 145);
-  gfx->println("BTN1: Next  BTN2: Select");
-  gfx->setCursor(10, 158);
-  gfx->println("Hold BTN2: Routes");
-}
+  netEnd();
 
-String fetchStatus() {
-  WiFiClientSecure *client = new WiFiClientSecure;
-  client->setInsecure();
-  HTTPClient http;
+  if (httpCode == HTTP_CODE_NOT_FOUND) {
+    httpCode = fetchStatus(out.status[0], retryAfterMs);
+    out.count = out.status[0].version != 0 ? 1 : 0;
+  }
+  return httpCode;
+}
 
-  String url = String(serverUrl) + "/api/status";
+// Network task: fetches the vehicles of every watched trip in one request and
+// computes each watch's status from them
+static int fetchWatchesOnDevice(const Watchlist &watches, StatusBatch &out, unsigned long &retryAfterMs) {
+  // Two stops on one trip share its vehicles
+  uint8_t tripOf[WATCH_MAX];
+  int trips = 0;
+  String path = "/api/vehicles/compact?";
+  for (int i = 0; i < watches.count(); i++) {
+    int j = 0;
+    while (j < i && strcmp(watches[j].tripId, watches[i].tripId) != 0) j++;
+    if (j < i) {
+      tripOf[i] = tripOf[j];
+      continue;
+    }
+    if (trips > 0) path += "&";
+    path += "tripId=" + urlEncode(watches[i].tripId);
+    tripOf[i] = trips++;
+  }
 
-  if (!http.begin(*client, url)) {
-    delete client;
-    return "";
+  if (!netBegin(path)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
   }
 
-  int httpCode = http.GET();
-  String result = "";
+  int httpCode = netGet();
+
+  if (httpCode > 0) {
+    retryAfterMs = http.header("Retry-After").toInt() * 1000UL;
+  }
 
   if (httpCode == HTTP_CODE_OK) {
-    result = http.getString();
-    Serial.println("Status: " + result);
+    static uint8_t payload[VEHICLE_FEED_HEADER_SIZE + VEHICLE_FEED_MAX * VEHICLE_FEED_RECORD_SIZE];
+    static VehicleFeed feed;
+    size_t len = netReadBody(payload, sizeof(payload));
+    if (decodeVehicleFeed(payload, len, feed)) {
+      for (int i = 0; i < watches.count(); i++) {
+        WatchState &state = watchStates[i];
+        computeStatus(state.stops, state.userStop, feed, tripOf[i], state.tracker, state.last, out.status[i]);
+        state.last = out.status[i];
+      }
+      out.count = watches.count();
+      if (feedMissingCount > 0) {
+        Serial.println("[STATUS] Vehicle feed is back, computing the status on the device");
+        feedMissingCount = 0;
+      }
+      Serial.println("Status: " + String(out.count) + " stops, " + String(feed.count) + " vehicles");
+    } else if (len > 0 && payload[0] != VEHICLE_FEED_VERSION) {
+      Serial.println("[STATUS] Vehicle feed version " + String(payload[0]) + ", using the backend's status");
+      markFeedMissing();
+    } else {
+      Serial.println("[STATUS] ERROR: Bad vehicle feed (" + String(len) + " bytes)");
+    }
+  } else if (httpCode > 0) {
+    http.getString();
+  }
+
+  netEnd();
+
+  if (httpCode == HTTP_CODE_NOT_FOUND) {
+    Serial.println("[STATUS] No vehicle feed on the backend, using its status");
+    markFeedMissing();
+  }
+  if (vehicleFeedMissing()) {
+    return fetchStatusBatch(watches, out, retryAfterMs);
+  }
+  return httpCode;
+}
+
+// Network task: the status of every watched stop, same contract as
+// fetchStatus() with out.count 0 when the poll failed. Computed on the device
+// once each watch's stops are loaded, by the backend until then.
+int fetchWatchStatuses(const Watchlist &watches, StatusBatch &out, unsigned long &retryAfterMs) {
+  memset(&out, 0, sizeof(out));
+  retryAfterMs = 0;
+  syncWatchStates(watches);
+
+  bool onDevice = !vehicleFeedMissing();
+  for (int i = 0; i < watches.count() && onDevice; i++) {
+    onDevice = watchStates[i].loaded || loadWatchStops(watchStates[i]);
   }
 
-  http.end();
-  delete client;
-  return result;
+  return onDevice ? fetchWatchesOnDevice(watches, out, retryAfterMs) : fetchStatusBatch(watches, out, retryAfterMs);
 }
 
+// Network task: tells the backend which stop to track on tripId (selecting
+// the trip in this device's session), returns the HTTP code
+int postUserLocation(double lat, double lon, const String &name, const char *tripId) {
+  String path = "/api/user-location";
+  path += "?lat=" + String(lat, 6);
+  path += "&lon=" + String(lon, 6);
+  path += "&name=" + urlEncode(name.c_str());
+  if (tripId[0] != '\0') {
+    path += "&tripId=" + urlEncode(tripId);
+  }
 
+  if (!netBegin(path)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
 
+  int httpCode = netPost("");
+  http.getString();  // drain the reply so the kept-alive socket is clean for the next request
+
+  netEnd();
+  return httpCode;
+}
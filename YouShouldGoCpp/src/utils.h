@@ -1,24 +1,43 @@
 #pragma once
 //pragma to only include once
 #include "app.h"
+#include "compactstatus.h"
+#include "watchlist.h"
 // utils.h includes function declarations
 void showMessage(const String &text, uint16_t color = WHITE, int textSize = 2, int y = 60);
 void displayWrappedText(const String &text, int startY = 40);
+// Redraws only the WiFi indicator over what the panel shows
+void showLinkState();
 void drawClearPopup(unsigned long remainingMs);
 void initDisplay();
+void displayPowerDown();
 void initNVS();
 void clearNVS();
-void saveRoutesToNVS();
-bool loadRoutesFromNVS();
-void saveTripsToNVS(int routeId);
-bool loadTripsFromNVS(int routeId);
-void saveStationsToNVS();
-bool loadStationsFromNVS();
+void resetCatalog();
+void saveRoutesToNVS(const std::vector<Route> &list);
+bool loadRoutesFromNVS(ListPage<Route> &page);
+void saveTripsToNVS(int routeId, const std::vector<Trip> &list);
+bool loadTripsFromNVS(int routeId, ListPage<Trip> &page);
+String stationsKey(const char *tripId);
+void saveStationsToNVS(const String &key, const std::vector<Station> &list);
+bool loadStationsFromNVS(const String &key, ListPage<Station> &page);
+// UI side: queue a load, the list arrives later as a NetResult
 void loadRoutes();
-void displayCurrentRoute();
 void loadTripsForRoute(int routeId);
-void displayCurrentTrip();
 void loadStations();
+// Network task side: do the actual NVS/HTTP work and post NetResults
+void fetchRoutes(uint32_t seq, int offset);
+void fetchTrips(uint32_t seq, int routeId, int offset);
+void fetchStations(uint32_t seq, const char *tripId, int offset);
+void warmTrips(uint32_t seq, int routeId);
+void warmStations(uint32_t seq, const char *tripId);
+int postUserLocation(double lat, double lon, const String &name, const char *tripId);
+int fetchStatus(CompactStatus &status, unsigned long &retryAfterMs);
+int fetchWatchStatuses(const Watchlist &watches, StatusBatch &out, unsigned long &retryAfterMs);
+void displayCurrentRoute();
+void displayCurrentTrip();
 void displayCurrentStation();
-String fetchStatus();
+void displayStatus(const CompactStatus &status);
+void displayWatchlist(const Watchlist &watches, const StatusBatch &batch, int cursor);
+void displayDiagnostics();
 void selectStation();
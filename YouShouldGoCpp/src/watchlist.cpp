@@ -0,0 +1,117 @@
+#include "watchlist.h"
+#include "cache.h"
+#include "kvstore.h"
+
+struct __attribute__((packed)) PackedWatch {
+  uint32_t tripId;
+  uint32_t routeName;
+  uint32_t stopName;
+  int32_t lat_e6;  // same precision as the stations cache
+  int32_t lon_e6;
+};
+
+// Coordinates compared at the precision they are stored with, a stop read
+// back from NVS is the same stop
+bool sameWatch(const Watch &a, const Watch &b) {
+  return strcmp(a.tripId, b.tripId) == 0 && lround(a.lat * 1e6) == lround(b.lat * 1e6) &&
+         lround(a.lon * 1e6) == lround(b.lon * 1e6);
+}
+
+int Watchlist::find(const Watch &watch) const {
+  for (int i = 0; i < _count; i++) {
+    if (sameWatch(_watches[i], watch)) return i;
+  }
+  return -1;
+}
+
+void Watchlist::add(const Watch &watch) {
+  int existing = find(watch);
+  if (existing >= 0) {
+    remove(existing);
+  }
+
+  int last = _count < WATCH_MAX ? _count : WATCH_MAX - 1;
+  for (int i = last; i > 0; i--) {
+    _watches[i] = _watches[i - 1];
+  }
+  _watches[0] = watch;
+  if (_count < WATCH_MAX) _count++;
+}
+
+void Watchlist::remove(int index) {
+  if (index < 0 || index >= _count) return;
+  for (int i = index; i < _count - 1; i++) {
+    _watches[i] = _watches[i + 1];
+  }
+  _count--;
+}
+
+void encodeWatchlist(const Watchlist &list, std::vector<uint8_t> &blob) {
+  StringTable strings;
+  std::vector<PackedWatch> packed(list.count());
+
+  for (size_t i = 0; i < list.count(); i++) {
+    const Watch &w = list[i];
+    PackedWatch &p = packed[i];
+    p.tripId = strings.add(w.tripId);
+    p.routeName = strings.add(w.routeName);
+    p.stopName = strings.add(w.stopName);
+    p.lat_e6 = lround(w.lat * 1e6);
+    p.lon_e6 = lround(w.lon * 1e6);
+  }
+
+  cacheEncode(blob, sizeof(PackedWatch), packed.size(), packed.data(), strings);
+}
+
+bool decodeWatchlist(const std::vector<uint8_t> &blob, Watchlist &list) {
+  list.clear();
+
+  CacheView view;
+  if (cacheDecode(blob, view) != CACHE_OK) {
+    return false;
+  }
+
+  // Added oldest first so the order comes out as it was saved
+  for (uint32_t i = view.recordCount; i-- > 0;) {
+    PackedWatch p;
+    cacheRecordAt(view, i, p);
+    Watch w = {};
+    strlcpy(w.tripId, cacheString(view, p.tripId), sizeof(w.tripId));
+    strlcpy(w.routeName, cacheString(view, p.routeName), sizeof(w.routeName));
+    strlcpy(w.stopName, cacheString(view, p.stopName), sizeof(w.stopName));
+    w.lat = p.lat_e6 / 1e6;
+    w.lon = p.lon_e6 / 1e6;
+    list.add(w);
+  }
+  return true;
+}
+
+bool loadWatchlist(Watchlist &list) {
+  std::vector<uint8_t> blob;
+  if (!kvStore->getBlob("watches", blob)) {
+    list.clear();
+    return false;
+  }
+
+  if (!decodeWatchlist(blob, list)) {
+    Serial.println("[NVS] ERROR: watchlist blob rejected");
+    return false;
+  }
+  Serial.println("[NVS] Loaded " + String(list.count()) + " watched stops");
+  return true;
+}
+
+bool saveWatchlist(const Watchlist &list) {
+  if (list.empty()) {
+    kvStore->erase("watches");
+    return true;
+  }
+
+  std::vector<uint8_t> blob;
+  encodeWatchlist(list, blob);
+  if (!kvStore->setBlob("watches", blob)) {
+    Serial.println("[NVS] WARNING: Watchlist was not saved");
+    return false;
+  }
+  return true;
+}
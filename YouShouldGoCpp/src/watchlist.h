@@ -0,0 +1,53 @@
+#pragma once
+//pragma to only include once
+#include "app.h"
+#include "compactstatus.h"
+// watchlist.h declares the stops the device tracks and their NVS copy
+//
+// Each watch is a stop on a trip, picked on the stations screen. The whole
+// list is answered by one request per status poll (see fetchWatchStatuses()
+// in utils.cpp), newest first, and kept in NVS as a packed cache blob
+// (cache.h) under "watches".
+
+#define WATCH_MAX STATUS_BATCH_MAX
+#define WATCH_TRIP_ID_LEN 24
+#define WATCH_ROUTE_NAME_LEN 12
+
+struct Watch {
+  char tripId[WATCH_TRIP_ID_LEN];
+  char routeName[WATCH_ROUTE_NAME_LEN];  // route_short_name, for the screen only
+  char stopName[32];
+  double lat;
+  double lon;
+};
+
+// Plain data, so a copy can travel to the network task with a request
+class Watchlist {
+public:
+  uint8_t count() const { return _count; }
+  bool empty() const { return _count == 0; }
+  const Watch &operator[](size_t index) const { return _watches[index]; }
+
+  // Index of the watch on the same trip and stop, -1 if there is none
+  int find(const Watch &watch) const;
+  // Puts watch first, moving it if it is already there and dropping the
+  // oldest one when the list is full
+  void add(const Watch &watch);
+  void remove(int index);
+  void clear() { _count = 0; }
+
+private:
+  Watch _watches[WATCH_MAX];
+  uint8_t _count = 0;
+};
+
+// The UI's list and the trip the stations screen lists, defined in main.cpp
+extern Watchlist watchlist;
+extern char selectedTripId[WATCH_TRIP_ID_LEN];
+extern char selectedRouteName[WATCH_ROUTE_NAME_LEN];
+
+bool sameWatch(const Watch &a, const Watch &b);
+void encodeWatchlist(const Watchlist &list, std::vector<uint8_t> &blob);
+bool decodeWatchlist(const std::vector<uint8_t> &blob, Watchlist &list);
+bool loadWatchlist(Watchlist &list);
+bool saveWatchlist(const Watchlist &list);
@@ -0,0 +1,111 @@
+#pragma once
+//pragma to only include once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "arena.h"
+// window.h declares ListWindow, a bounded slice of a server-side list
+//
+// Lists are fetched in pages of LIST_PAGE_SIZE records. Only the pages
+// around the current index are kept, so memory does not grow with the
+// agency. Indices are always list indices, operator[] is only valid for
+// has(index).
+
+#define LIST_PAGE_SIZE 16
+#define LIST_WINDOW_PAGES 3      // pages kept around the current index
+#define LIST_PREFETCH_MARGIN 4   // fetch the next page this close to the window end
+
+inline int listPageOffset(int index) {
+  return (index / LIST_PAGE_SIZE) * LIST_PAGE_SIZE;
+}
+
+// Records of one page plus the arena their strings live in. Dropping the
+// page releases all of its strings in one go.
+//
+// The arena is per page rather than per list on purpose. Pages are built on
+// the network task and handed over whole, and the window drops them one at
+// a time as it slides. A list-wide arena would need locking across the two
+// tasks, and could only free anything on reload, so it would grow with
+// every page scrolled past. The cost is that strings repeated across pages
+// (headsigns, route names) are stored once per page, plus one block and
+// dedup table per page: at most LIST_WINDOW_PAGES of each.
+template <typename T>
+struct ListPage {
+  std::vector<T> items;
+  std::unique_ptr<StringArena> strings;
+
+  ListPage() : strings(new StringArena()) {}
+};
+
+template <typename T>
+class ListWindow {
+public:
+  int total = 0;     // records in the whole list on the server
+  int start = 0;     // list index of the first record of pages[0]
+  int owner = -1;    // what the list belongs to (route_id for trips)
+  std::vector<ListPage<T>> pages;  // consecutive, all full except maybe the last
+
+  int size() const { return total; }
+  bool empty() const { return total == 0; }
+  int end() const {
+    return pages.empty() ? start : start + (int)(pages.size() - 1) * LIST_PAGE_SIZE + (int)pages.back().items.size();
+  }
+  bool has(int index) const { return index >= start && index < end(); }
+
+  T &operator[](int index) {
+    int rel = index - start;
+    return pages[rel / LIST_PAGE_SIZE].items[rel % LIST_PAGE_SIZE];
+  }
+  const T &operator[](int index) const {
+    int rel = index - start;
+    return pages[rel / LIST_PAGE_SIZE].items[rel % LIST_PAGE_SIZE];
+  }
+
+  void clear() {
+    total = 0;
+    start = 0;
+    owner = -1;
+    pages.clear();
+  }
+
+  // Takes over the page loaded at offset (page aligned). A page that does
+  // not touch the window replaces it. Afterwards at most LIST_WINDOW_PAGES
+  // pages are kept, dropping those on the side further from keepIndex.
+  void merge(int offset, int newTotal, ListPage<T> &page, int keepIndex) {
+    total = newTotal;
+
+    if (!page.items.empty()) {
+      if (pages.empty() || offset > end() || offset + LIST_PAGE_SIZE < start) {
+        pages.clear();
+        pages.push_back(std::move(page));
+        start = offset;
+      } else if (offset == end()) {
+        pages.push_back(std::move(page));
+      } else if (offset + LIST_PAGE_SIZE == start) {
+        pages.insert(pages.begin(), std::move(page));
+        start = offset;
+      } else {
+        pages[(offset - start) / LIST_PAGE_SIZE] = std::move(page);
+      }
+    }
+
+    // The list may have shrunk on the server
+    while (!pages.empty() && end() > total) {
+      int lastStart = start + (int)(pages.size() - 1) * LIST_PAGE_SIZE;
+      if (lastStart >= total) {
+        pages.pop_back();
+      } else {
+        pages.back().items.resize(total - lastStart);
+      }
+    }
+
+    while ((int)pages.size() > LIST_WINDOW_PAGES) {
+      if (keepIndex - start >= (int)pages.size() * LIST_PAGE_SIZE / 2) {
+        pages.erase(pages.begin());
+        start += LIST_PAGE_SIZE;
+      } else {
+        pages.pop_back();
+      }
+    }
+  }
+};